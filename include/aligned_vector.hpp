@@ -1,4 +1,6 @@
+#pragma once
 #include "common.hpp"
+#include "metrics.hpp"
 #include "utils.hpp"
 
 namespace xarrow {
@@ -6,26 +8,63 @@ static constexpr auto align_round(size_t const size, size_t const align) {
   return (size + align - 1) / align * align;
 }
 
-template <size_t Alignment> struct AlignedBuffer {
+/**
+ * @brief default allocator backend, plain aligned heap memory
+ * An allocator provides allocate(alignment, size), returning nullptr on
+ * failure, and deallocate(ptr). It may carry state, e.g. an arena pointer.
+ */
+struct MallocAllocator {
+  [[nodiscard]] static auto allocate(size_t const alignment,
+                                     size_t const size) noexcept -> void * {
+    return std::aligned_alloc(alignment, size);
+  }
+  static void deallocate(void *ptr) noexcept {
+    std::free(ptr); // NOLINT
+  }
+};
+
+// allocator is a private base so that stateless ones take no space
+template <size_t Alignment, class Allocator = MallocAllocator>
+struct AlignedBuffer : private Allocator {
   static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0,
                 "Alignment must be a power of 2");
 
   AlignedBuffer() noexcept : data_(nullptr) {}
-  explicit AlignedBuffer(size_t const size)
-      : data_(std::aligned_alloc(Alignment, align_round(size, Alignment))) {
+  explicit AlignedBuffer(Allocator const &alloc) noexcept
+      : Allocator(alloc), data_(nullptr) {}
+  explicit AlignedBuffer(size_t const size,
+                         Allocator const &alloc = Allocator())
+      : AlignedBuffer(size, Alignment, alloc) {}
+  /**
+   * @brief start aligned to max(alignment, Alignment), e.g. for O_DIRECT
+   */
+  AlignedBuffer(size_t const size, size_t const alignment,
+                Allocator const &alloc)
+      : Allocator(alloc), data_(this->allocate(std::max(alignment, Alignment),
+                                               rounded(size, alignment))) {
     if (data_ == nullptr) {
       throw std::bad_alloc();
     }
+    bytes_ = rounded(size, alignment);
+    metrics::on_allocate(bytes_);
   }
   ~AlignedBuffer() noexcept {
-    std::free(data_); // NOLINT
+    if (data_ != nullptr) {
+      this->deallocate(data_);
+      metrics::on_free(bytes_);
+    }
   }
-  AlignedBuffer(AlignedBuffer &&other) noexcept : data_(other.data_) {
+  AlignedBuffer(AlignedBuffer &&other) noexcept
+      : Allocator(other.get_allocator()), data_(other.data_),
+        bytes_(std::exchange(other.bytes_, 0)) {
     other.data_ = nullptr;
   }
   auto operator=(AlignedBuffer &&other) noexcept -> AlignedBuffer & {
     if (this != &other) {
+      std::swap(static_cast<Allocator &>(*this),
+                static_cast<Allocator &>(other));
       std::swap(data_, other.data_);
+      std::swap(bytes_, other.bytes_);
       // rvalue other will be destructed afterwards
     }
     return *this;
@@ -35,6 +74,9 @@ template <size_t Alignment> struct AlignedBuffer {
 
   [[nodiscard]] auto data() -> void * { return data_; }
   [[nodiscard]] auto data() const -> const void * { return data_; }
+  [[nodiscard]] auto get_allocator() const noexcept -> Allocator const & {
+    return *this;
+  }
 
   /**
    * @brief Never call this function unless you know what you are doing!
@@ -43,16 +85,32 @@ template <size_t Alignment> struct AlignedBuffer {
   void _leak() { data_ = nullptr; }
 
 private:
+  static auto rounded(size_t const size, size_t const alignment) -> size_t {
+    return align_round(size, std::max(alignment, Alignment));
+  }
+
   owner<void *> data_;
+  // kept whatever XARROW_METRICS says, so the layout never depends on it;
+  // counted as live until freed, leaked memory stays live
+  size_t bytes_ = 0;
 };
 
-template <class T, size_t Alignment> struct AlignedArray {
+template <class T, size_t Alignment, class Allocator = MallocAllocator>
+struct AlignedArray {
   AlignedArray() noexcept : size_(0), buffer_() {}
-  explicit AlignedArray(size_t const element_size)
-      : size_(element_size), buffer_(element_size * sizeof(T)) {}
+  explicit AlignedArray(Allocator const &alloc) noexcept
+      : size_(0), buffer_(alloc) {}
+  explicit AlignedArray(size_t const element_size,
+                        Allocator const &alloc = Allocator())
+      : size_(element_size), buffer_(element_size * sizeof(T), alloc) {}
+  AlignedArray(size_t const element_size, size_t const alignment,
+               Allocator const &alloc)
+      : size_(element_size),
+        buffer_(element_size * sizeof(T), alignment, alloc) {}
   ~AlignedArray() noexcept = default;
 
-  AlignedArray(AlignedArray const &other) : AlignedArray(other.size_) {
+  AlignedArray(AlignedArray const &other)
+      : AlignedArray(other.size_, other.get_allocator()) {
     std::memcpy(data(), other.data(), size_ * sizeof(T));
   }
   auto operator=(AlignedArray const &other) -> AlignedArray & {
@@ -81,6 +139,9 @@ template <class T, size_t Alignment> struct AlignedArray {
     return static_cast<T const *>(buffer_.data());
   }
   [[nodiscard]] auto size() const noexcept -> size_t { return size_; }
+  [[nodiscard]] auto get_allocator() const noexcept -> Allocator const & {
+    return buffer_.get_allocator();
+  }
 
   [[nodiscard]] auto begin() noexcept -> T * { return data(); }
   [[nodiscard]] auto begin() const noexcept -> T const * { return data(); }
@@ -127,10 +188,11 @@ template <class T, size_t Alignment> struct AlignedArray {
 
 private:
   size_t size_;
-  AlignedBuffer<Alignment> buffer_;
+  AlignedBuffer<Alignment, Allocator> buffer_;
 };
 
-template <typename T, size_t Alignment> class AlignedVector {
+template <typename T, size_t Alignment, class Allocator = MallocAllocator>
+class AlignedVector {
 public:
   using value_type = T;
   using size_type = std::size_t;
@@ -143,17 +205,24 @@ public:
   using const_iterator = const_pointer;
   using reverse_iterator = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using allocator_type = Allocator;
 
-  static_assert(std::is_fundamental_v<T>,
-                "T must be a fundamental type for AlignedVector");
+  // elements are moved around with memcpy
+  static_assert(std::is_trivially_copyable_v<T>,
+                "T must be trivially copyable for AlignedVector");
   static_assert(Alignment >= alignof(T),
                 "Alignment must be at least alignof(T)");
 
   // Constructors
-  AlignedVector() noexcept : size_(0), array_(4) {}
-
-  explicit AlignedVector(size_type count, const T &value = T())
-      : AlignedVector() {
+  // stateful allocators (e.g. ShmAllocator) must be passed explicitly
+  template <class A = Allocator,
+            std::enable_if_t<std::is_empty_v<A>, int> = 0>
+  AlignedVector() : size_(0), array_(4) {}
+  explicit AlignedVector(Allocator const &alloc) : size_(0), array_(4, alloc) {}
+
+  explicit AlignedVector(size_type count, const T &value = T(),
+                         Allocator const &alloc = Allocator())
+      : AlignedVector(alloc) {
     resize(count, value);
   }
 
@@ -163,7 +232,7 @@ public:
   // Assignment operators
   auto operator=(const AlignedVector &other) -> AlignedVector & {
     if (this != &other) {
-      AlignedVector<T, Alignment> tmp(other);
+      AlignedVector tmp(other);
       std::swap(size_, tmp.size_);
       std::swap(array_, tmp.array_);
     }
@@ -246,6 +315,9 @@ public:
   [[nodiscard]] auto capacity() const noexcept -> size_type {
     return array_.size();
   }
+  [[nodiscard]] auto get_allocator() const noexcept -> Allocator const & {
+    return array_.get_allocator();
+  }
 
   void reserve(size_type new_cap) {
     if (new_cap > capacity()) {
@@ -253,6 +325,18 @@ public:
     }
   }
 
+  /**
+   * @brief reallocate to new_cap elements starting at an alignment boundary
+   * stronger than Alignment, e.g. direct_alignment for O_DIRECT reads
+   * Later growth falls back to Alignment.
+   */
+  void reserve_aligned(size_type const new_cap, size_t const alignment) {
+    AlignedArray<T, Alignment, Allocator> bigger(
+        std::max({new_cap, size_, size_type{1}}), alignment, get_allocator());
+    std::memcpy(bigger.data(), data(), size_ * sizeof(T));
+    std::swap(array_, bigger);
+  }
+
   void shrink_to_fit() {
     if (size_ < capacity()) {
       reallocate(size_);
@@ -267,6 +351,18 @@ public:
 
   void push_back(const T &value) { emplace_back(value); }
 
+  /**
+   * @brief copy count values to the end, growing like push_back
+   */
+  void append(const T *values, size_type count) {
+    if (count == 0) {
+      return;
+    }
+    ensure_capacity(size_ + count);
+    std::memcpy(data() + size_, values, count * sizeof(T));
+    size_ += count;
+  }
+
   void push_back(T &&value) { emplace_back(std::move(value)); }
 
   template <typename... Args> auto emplace_back(Args &&...args) -> reference {
@@ -283,6 +379,15 @@ public:
 
   void resize(size_type count) { resize(count, T()); }
 
+  /**
+   * @brief resize without initializing the new elements
+   * For callers that overwrite them right away, e.g. reads and transposes.
+   */
+  void resize_uninitialized(size_type const count) {
+    ensure_capacity(count);
+    size_ = count;
+  }
+
   void resize(size_type count, const value_type &value) {
     if (count > size_) {
       // Grow
@@ -310,7 +415,7 @@ public:
 private:
 #endif
   size_t size_;
-  AlignedArray<T, Alignment> array_;
+  AlignedArray<T, Alignment, Allocator> array_;
 
   // Helper methods
   void ensure_capacity(size_type required_capacity) {
@@ -327,17 +432,20 @@ private:
   void reallocate(size_type new_capacity) {
     if (new_capacity == 0) {
       size_ = 0;
-      AlignedArray<T, Alignment> tmp;
+      AlignedArray<T, Alignment, Allocator> tmp(get_allocator());
       std::swap(array_, tmp);
       return;
     }
 
     // Allocate new array
-    auto new_array = AlignedArray<T, Alignment>(new_capacity);
+    auto new_array =
+        AlignedArray<T, Alignment, Allocator>(new_capacity, get_allocator());
 
     if (size_ > 0) {
       // Move existing elements to new array
       std::memcpy(new_array.data(), data(), size_ * sizeof(T));
+      metrics::add(metrics::Counter::REALLOC_BYTES_COPIED,
+                   static_cast<int64_t>(size_ * sizeof(T)));
     }
 
     std::swap(new_array, array_);
@@ -345,47 +453,47 @@ private:
 };
 
 // Non-member functions
-template <typename T, size_t Alignment>
-auto operator==(const AlignedVector<T, Alignment> &lhs,
-                const AlignedVector<T, Alignment> &rhs) -> bool {
+template <typename T, size_t Alignment, class Allocator>
+auto operator==(const AlignedVector<T, Alignment, Allocator> &lhs,
+                const AlignedVector<T, Alignment, Allocator> &rhs) -> bool {
   return lhs.size() == rhs.size() &&
          std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
-template <typename T, size_t Alignment>
-auto operator!=(const AlignedVector<T, Alignment> &lhs,
-                const AlignedVector<T, Alignment> &rhs) -> bool {
+template <typename T, size_t Alignment, class Allocator>
+auto operator!=(const AlignedVector<T, Alignment, Allocator> &lhs,
+                const AlignedVector<T, Alignment, Allocator> &rhs) -> bool {
   return !(lhs == rhs);
 }
 
-template <typename T, size_t Alignment>
-auto operator<(const AlignedVector<T, Alignment> &lhs,
-               const AlignedVector<T, Alignment> &rhs) -> bool {
+template <typename T, size_t Alignment, class Allocator>
+auto operator<(const AlignedVector<T, Alignment, Allocator> &lhs,
+               const AlignedVector<T, Alignment, Allocator> &rhs) -> bool {
   return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
                                       rhs.end());
 }
 
-template <typename T, size_t Alignment>
-auto operator<=(const AlignedVector<T, Alignment> &lhs,
-                const AlignedVector<T, Alignment> &rhs) -> bool {
+template <typename T, size_t Alignment, class Allocator>
+auto operator<=(const AlignedVector<T, Alignment, Allocator> &lhs,
+                const AlignedVector<T, Alignment, Allocator> &rhs) -> bool {
   return !(rhs < lhs);
 }
 
-template <typename T, size_t Alignment>
-auto operator>(const AlignedVector<T, Alignment> &lhs,
-               const AlignedVector<T, Alignment> &rhs) -> bool {
+template <typename T, size_t Alignment, class Allocator>
+auto operator>(const AlignedVector<T, Alignment, Allocator> &lhs,
+               const AlignedVector<T, Alignment, Allocator> &rhs) -> bool {
   return rhs < lhs;
 }
 
-template <typename T, size_t Alignment>
-auto operator>=(const AlignedVector<T, Alignment> &lhs,
-                const AlignedVector<T, Alignment> &rhs) -> bool {
+template <typename T, size_t Alignment, class Allocator>
+auto operator>=(const AlignedVector<T, Alignment, Allocator> &lhs,
+                const AlignedVector<T, Alignment, Allocator> &rhs) -> bool {
   return !(lhs < rhs);
 }
 
-template <typename T, size_t Alignment>
-void swap(AlignedVector<T, Alignment> &lhs,
-          AlignedVector<T, Alignment> &rhs) noexcept {
+template <typename T, size_t Alignment, class Allocator>
+void swap(AlignedVector<T, Alignment, Allocator> &lhs,
+          AlignedVector<T, Alignment, Allocator> &rhs) noexcept {
   lhs.swap(rhs);
 }
 } // namespace xarrow
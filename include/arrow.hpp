@@ -54,3 +54,25 @@ struct ArrowArray {
 };
 
 #endif // ARROW_C_DATA_INTERFACE
+
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
+
+// https://arrow.apache.org/docs/format/CStreamInterface.html
+struct ArrowArrayStream {
+  // Callback to get the stream type, the same for all arrays in the stream.
+  // Returns 0 or an errno-compatible error code.
+  int (*get_schema)(struct ArrowArrayStream *, struct ArrowSchema *out);
+  // Callback to get the next array, a released array marks the end.
+  // Returns 0 or an errno-compatible error code.
+  int (*get_next)(struct ArrowArrayStream *, struct ArrowArray *out);
+  // Description of the last error, or NULL, valid until the next call.
+  const char *(*get_last_error)(struct ArrowArrayStream *);
+
+  // Release callback, arrays from get_next are released independently
+  void (*release)(struct ArrowArrayStream *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+#endif // ARROW_C_STREAM_INTERFACE
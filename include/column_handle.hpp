@@ -0,0 +1,121 @@
+/**
+ * @file column_handle.hpp
+ * @brief Type-erased column views and kernel tables indexed by Type
+ *
+ * ColumnHandle is a small header over a non-null column: its Type, length,
+ * Arrow-ordered buffer pointers and borrowed name and format. Generic code
+ * over wide schemas turns each column into a handle once. It then fetches
+ * the typed kernel from a table built from types.def with one indexed load,
+ * instead of going through std::visit over every XArrowVariant alternative at
+ * each call site.
+ */
+#pragma once
+#include "common.hpp"
+#include "data_types.hpp"
+#include "xarrow.hpp"
+#include <string_view>
+
+namespace xarrow {
+#define OPT(type, enum_name, format_str) +1
+#define END(type, enum_name, format_str) +1
+constexpr static size_t type_count = 0
+#include "types.def"
+    ;
+#undef OPT
+#undef END
+
+/**
+ * @brief bytes per value of each Type, indexed by Type
+ */
+constexpr static std::array<size_t, type_count> type_sizes{
+#define OPT(type, enum_name, format_str) sizeof(type),
+#define END(type, enum_name, format_str) sizeof(type)
+#include "types.def"
+#undef OPT
+#undef END
+};
+
+constexpr auto type_size(Type const type) noexcept -> size_t {
+  return type_sizes[static_cast<size_t>(type)];
+}
+
+/**
+ * @brief borrowed view of a non-null column
+ * The handle does not own anything, the column must outlive it.
+ */
+struct ColumnHandle {
+  Type type;
+  size_t length;
+  // Arrow order: validity (always null here), then values
+  std::array<const void *, 2> buffers;
+  std::string_view name;
+  std::string_view format;
+
+  /**
+   * @brief typed values, throws std::invalid_argument if T is not the type
+   */
+  template <class T> [[nodiscard]] auto values() const -> T const * {
+    if (type != type2type_enum<T>()) [[unlikely]] {
+      throw std::invalid_argument("ColumnHandle: type mismatch");
+    }
+    return static_cast<T const *>(buffers[1]);
+  }
+  [[nodiscard]] auto bytes() const noexcept -> size_t {
+    return length * type_size(type);
+  }
+};
+
+template <class T>
+auto column_handle(XArrowNonNull<T> const &column) noexcept -> ColumnHandle {
+  return {type2type_enum<T>(),
+          column.data().size(),
+          {nullptr, column.data().data()},
+          column.name(),
+          column.type_format()};
+}
+template <class T>
+auto column_handle(XArrowSlice<T> const &slice) noexcept -> ColumnHandle {
+  return {type2type_enum<T>(),
+          slice.size(),
+          {nullptr, slice.data()},
+          slice.name(),
+          slice.type_format()};
+}
+/**
+ * @brief handle of whichever column the variant holds, without std::visit
+ * Throws std::bad_variant_access when the variant is valueless.
+ */
+auto column_handle(XArrowVariant const &column) -> ColumnHandle;
+auto column_handles(std::vector<XArrowVariant> const &columns)
+    -> std::vector<ColumnHandle>;
+
+/**
+ * @brief &Kernel<T>::run for every T in types.def, indexed by Type
+ * Every Kernel<T>::run must share one signature; kernels that do not support
+ * some T still provide run and throw from it.
+ */
+template <template <class> class Kernel>
+constexpr static std::array kernel_table{
+#define OPT(type, enum_name, format_str) &Kernel<type>::run,
+#define END(type, enum_name, format_str) &Kernel<type>::run
+#include "types.def"
+#undef OPT
+#undef END
+};
+
+/**
+ * @brief the kernel for one Type, resolve once and call it per batch
+ */
+template <template <class> class Kernel>
+constexpr auto kernel_for(Type const type) noexcept {
+  return kernel_table<Kernel>[static_cast<size_t>(type)];
+}
+
+/**
+ * @brief Kernel<T>::run(column, args...) for the column's T
+ */
+template <template <class> class Kernel, class... Args>
+auto dispatch(ColumnHandle const &column, Args &&...args) -> decltype(auto) {
+  return kernel_for<Kernel>(column.type)(column, std::forward<Args>(args)...);
+}
+} // namespace xarrow
@@ -1,6 +1,14 @@
+#pragma once
 #include "common.hpp"
+#include "logical_types.hpp"
+
+#define XARROW_STRINGIFY(x) #x
 
 namespace xarrow {
+namespace detail {
+template <class T> constexpr static bool always_false_v = false;
+} // namespace detail
+
 #define OPT(type, enum_name, format_str) enum_name,
 #define END(type, enum_name, format_str) enum_name
 enum class Type : uint8_t {
@@ -9,13 +17,16 @@ enum class Type : uint8_t {
 #undef OPT
 #undef END
 
+/**
+ * @brief format of a type, only the prefix for parameterized types
+ */
 static constexpr auto type_enum2format(Type type) {
 #define OPT(type, enum_name, format_str)                                       \
   case Type::enum_name:                                                        \
-    return " #format_str ";
+    return XARROW_STRINGIFY(format_str);
 #define END(type, enum_name, format_str)                                       \
   case Type::enum_name:                                                        \
-    return " #format_str ";
+    return XARROW_STRINGIFY(format_str);
 
   switch (type) {
 #include "types.def"
@@ -27,8 +38,25 @@ static constexpr auto type_enum2format(Type type) {
 }
 
 static auto format2type_enum(const char *format) {
+  // parameterized formats, matched by prefix
+  std::string_view const view(format);
+  if (view.rfind("d:", 0) == 0) {
+    return parse_decimal_format(view).bit_width == 256 ? Type::DECIMAL256
+                                                       : Type::DECIMAL128;
+  }
+  if (view.size() >= 4 && view.rfind("ts", 0) == 0 && view[3] == ':') {
+    time_unit_from_char(view[2]);
+    return Type::TIMESTAMP;
+  }
+  if (view.size() == 3 && view.rfind("tD", 0) == 0) {
+    time_unit_from_char(view[2]);
+    return Type::DURATION;
+  }
+  if (view == "d" || view == "ts" || view == "tD") {
+    throw std::runtime_error("Unsupported format");
+  }
 #define OPT(type, enum_name, format_str)                                       \
-  if (strcmp(format, " #format_str ") == 0) {                                  \
+  if (strcmp(format, XARROW_STRINGIFY(format_str)) == 0) {                     \
     return Type::enum_name;                                                    \
   }
 #define END(type, enum_name, format_str) OPT(type, enum_name, format_str)
@@ -38,15 +66,35 @@ static auto format2type_enum(const char *format) {
   throw std::runtime_error("Unsupported format");
 }
 
-template <class T> constexpr static auto type2format() {
+template <class T> constexpr static auto type2type_enum() -> Type {
 #define OPT(type, enum_name, format_str)                                       \
   if constexpr (std::is_same_v<T, type>) {                                     \
-    return " #format_str ";                                                    \
+    return Type::enum_name;                                                    \
+  } else
+
+#define END(type, enum_name, format_str) OPT(type, enum_name, format_str)
+#include "types.def"
+  {
+    static_assert(detail::always_false_v<T>, "Unsupported type");
   }
+#undef OPT
+#undef END
+}
+
+/**
+ * @brief format of T, only the prefix for parameterized types
+ */
+template <class T> constexpr static auto type2format() -> const char * {
+#define OPT(type, enum_name, format_str)                                       \
+  if constexpr (std::is_same_v<T, type>) {                                     \
+    return XARROW_STRINGIFY(format_str);                                       \
+  } else
 
 #define END(type, enum_name, format_str) OPT(type, enum_name, format_str)
 #include "types.def"
-  static_assert(false, "Unsupported type");
+  {
+    static_assert(detail::always_false_v<T>, "Unsupported type");
+  }
 #undef OPT
 #undef END
 }
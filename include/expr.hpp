@@ -0,0 +1,247 @@
+/**
+ * @file expr.hpp
+ * @brief Lazy, fused element-wise expressions over columns
+ *
+ * Operators on XArrowNonNull / XArrowSlice columns and arithmetic scalars
+ * build a compile-time expression tree instead of computing anything, e.g.
+ * `a * 2 + b > c`. evaluate and evaluate_bitmap then run the whole tree as
+ * one loop over the rows, without intermediate columns.
+ *
+ * Expressions only borrow their columns: keep them alive, and do not resize
+ * them, until the expression has been evaluated.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "common.hpp"
+#include "xarrow.hpp"
+#include <functional>
+#include <limits>
+
+namespace xarrow {
+// rows evaluate_bitmap computes into a byte buffer before packing them
+constexpr static size_t expr_block_rows = 1024;
+
+namespace detail {
+template <class T>
+using plain_t = std::remove_cv_t<std::remove_reference_t<T>>;
+
+// size of a scalar, which broadcasts to any length
+constexpr static size_t broadcast = std::numeric_limits<size_t>::max();
+
+inline auto common_size(size_t const lhs, size_t const rhs) -> size_t {
+  if (lhs == broadcast) {
+    return rhs;
+  }
+  if (rhs != broadcast && lhs != rhs) {
+    throw std::invalid_argument("expression: column lengths differ");
+  }
+  return lhs;
+}
+
+template <class T> struct ColumnExpr {
+  static_assert(std::is_arithmetic_v<T>,
+                "expressions are defined over numeric and bool columns");
+  using value_type = T;
+  T const *data;
+  size_t rows;
+
+  [[nodiscard]] auto size() const noexcept -> size_t { return rows; }
+  auto operator[](size_t const i) const noexcept -> T { return data[i]; }
+};
+
+template <class T> struct ScalarExpr {
+  using value_type = T;
+  T value;
+
+  [[nodiscard]] static auto size() noexcept -> size_t { return broadcast; }
+  auto operator[](size_t /*unused*/) const noexcept -> T { return value; }
+};
+
+template <class Op, class E> struct UnaryExpr {
+  using value_type =
+      plain_t<decltype(Op{}(std::declval<typename E::value_type>()))>;
+  E operand;
+
+  [[nodiscard]] auto size() const noexcept -> size_t { return operand.size(); }
+  auto operator[](size_t const i) const noexcept -> value_type {
+    return Op{}(operand[i]);
+  }
+};
+
+template <class Op, class L, class R> struct BinaryExpr {
+  using value_type =
+      plain_t<decltype(Op{}(std::declval<typename L::value_type>(),
+                            std::declval<typename R::value_type>()))>;
+  L lhs;
+  R rhs;
+  size_t rows;
+
+  BinaryExpr(L l, R r)
+      : lhs(std::move(l)), rhs(std::move(r)),
+        rows(common_size(lhs.size(), rhs.size())) {}
+
+  [[nodiscard]] auto size() const noexcept -> size_t { return rows; }
+  auto operator[](size_t const i) const noexcept -> value_type {
+    return Op{}(lhs[i], rhs[i]);
+  }
+};
+
+template <class T> struct is_expr : std::false_type {};
+template <class T> struct is_expr<ColumnExpr<T>> : std::true_type {};
+template <class T> struct is_expr<ScalarExpr<T>> : std::true_type {};
+template <class Op, class E>
+struct is_expr<UnaryExpr<Op, E>> : std::true_type {};
+template <class Op, class L, class R>
+struct is_expr<BinaryExpr<Op, L, R>> : std::true_type {};
+
+template <class T> struct is_column : std::false_type {};
+template <class T> struct is_column<XArrowNonNull<T>> : std::true_type {};
+template <class T> struct is_column<XArrowSlice<T>> : std::true_type {};
+
+// anything an operator may take: at least one side must be a column or
+// expression so plain arithmetic is left alone
+template <class T>
+constexpr static bool is_node_v =
+    is_expr<plain_t<T>>::value || is_column<plain_t<T>>::value;
+template <class T>
+constexpr static bool is_operand_v =
+    is_node_v<T> || std::is_arithmetic_v<plain_t<T>>;
+
+template <class T> auto to_expr(XArrowNonNull<T> const &column) {
+  return ColumnExpr<T>{column.data().data(), column.data().size()};
+}
+template <class T> auto to_expr(XArrowSlice<T> const &column) {
+  return ColumnExpr<T>{column.data(), column.size()};
+}
+template <class T> auto to_expr(T const &operand) {
+  if constexpr (is_expr<T>::value) {
+    return operand;
+  } else {
+    return ScalarExpr<T>{operand};
+  }
+}
+
+template <class T> constexpr void check_borrow() {
+  static_assert(!is_column<plain_t<T>>::value || std::is_lvalue_reference_v<T>,
+                "expressions borrow columns, a temporary column would dangle");
+}
+
+template <class Op, class L, class R> auto make_binary(L &&lhs, R &&rhs) {
+  check_borrow<L>();
+  check_borrow<R>();
+  auto l = to_expr(lhs);
+  auto r = to_expr(rhs);
+  return BinaryExpr<Op, decltype(l), decltype(r)>(std::move(l), std::move(r));
+}
+
+template <class Op, class E> auto make_unary(E &&operand) {
+  check_borrow<E>();
+  auto e = to_expr(operand);
+  return UnaryExpr<Op, decltype(e)>{std::move(e)};
+}
+} // namespace detail
+
+#define XARROW_EXPR_BINARY(op, functor)                                        \
+  template <class L, class R,                                                  \
+            std::enable_if_t<(detail::is_node_v<L> || detail::is_node_v<R>)&&  \
+                                 detail::is_operand_v<L> &&                    \
+                                 detail::is_operand_v<R>,                      \
+                             int> = 0>                                         \
+  auto operator op(L &&lhs, R &&rhs) {                                         \
+    return detail::make_binary<functor>(std::forward<L>(lhs),                  \
+                                        std::forward<R>(rhs));                 \
+  }
+XARROW_EXPR_BINARY(+, std::plus<>)
+XARROW_EXPR_BINARY(-, std::minus<>)
+XARROW_EXPR_BINARY(*, std::multiplies<>)
+XARROW_EXPR_BINARY(/, std::divides<>)
+XARROW_EXPR_BINARY(==, std::equal_to<>)
+XARROW_EXPR_BINARY(!=, std::not_equal_to<>)
+XARROW_EXPR_BINARY(<, std::less<>)
+XARROW_EXPR_BINARY(<=, std::less_equal<>)
+XARROW_EXPR_BINARY(>, std::greater<>)
+XARROW_EXPR_BINARY(>=, std::greater_equal<>)
+// both sides are always evaluated, there is no short circuit
+XARROW_EXPR_BINARY(&&, std::logical_and<>)
+XARROW_EXPR_BINARY(||, std::logical_or<>)
+#undef XARROW_EXPR_BINARY
+
+#define XARROW_EXPR_UNARY(op, functor)                                         \
+  template <class E, std::enable_if_t<detail::is_node_v<E>, int> = 0>          \
+  auto operator op(E &&operand) {                                              \
+    return detail::make_unary<functor>(std::forward<E>(operand));              \
+  }
+XARROW_EXPR_UNARY(-, std::negate<>)
+XARROW_EXPR_UNARY(!, std::logical_not<>)
+#undef XARROW_EXPR_UNARY
+
+/**
+ * @brief evaluate expr into out in one fused pass, resizing out to its length
+ * Results are converted to T as by static_cast.
+ */
+template <class E, class T, size_t Alignment, class Allocator,
+          std::enable_if_t<detail::is_expr<E>::value, int> = 0>
+void evaluate(E const &expr, AlignedVector<T, Alignment, Allocator> &out) {
+  auto const n = expr.size();
+  if (n == detail::broadcast) {
+    throw std::invalid_argument("expression: no column to take a length from");
+  }
+  out.resize(n);
+  metrics::KernelTimer const timer(n);
+  T *dst = out.data();
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = static_cast<T>(expr[i]);
+  }
+}
+
+template <class E, std::enable_if_t<detail::is_expr<E>::value, int> = 0>
+[[nodiscard]] auto evaluate(E const &expr)
+    -> AlignedVector<typename E::value_type, alignment> {
+  AlignedVector<typename E::value_type, alignment> out;
+  evaluate(expr, out);
+  return out;
+}
+
+/**
+ * @brief evaluate a predicate into an Arrow bitmap, least significant bit
+ * first, with the padding bits of the last byte cleared
+ * @return number of rows where the predicate holds
+ */
+template <class E, size_t Alignment, class Allocator,
+          std::enable_if_t<detail::is_expr<E>::value, int> = 0>
+auto evaluate_bitmap(E const &expr,
+                     AlignedVector<uint8_t, Alignment, Allocator> &bits)
+    -> size_t {
+  static_assert(std::is_same_v<typename E::value_type, bool>,
+                "evaluate_bitmap needs a boolean expression");
+  static_assert(expr_block_rows % 8 == 0);
+  auto const n = expr.size();
+  if (n == detail::broadcast) {
+    throw std::invalid_argument("expression: no column to take a length from");
+  }
+  bits.resize((n + 7) / 8);
+  metrics::KernelTimer const timer(n);
+  uint8_t *dst = bits.data();
+  std::array<uint8_t, expr_block_rows> block{};
+  size_t set = 0;
+  for (size_t begin = 0; begin < n; begin += expr_block_rows) {
+    auto const rows = std::min(n - begin, expr_block_rows);
+    for (size_t i = 0; i < rows; ++i) {
+      block[i] = expr[begin + i] ? 1 : 0;
+    }
+    std::fill(block.begin() + static_cast<std::ptrdiff_t>(rows), block.end(),
+              uint8_t{0});
+    for (size_t byte = 0; byte < (rows + 7) / 8; ++byte) {
+      uint8_t packed = 0;
+      for (size_t bit = 0; bit < 8; ++bit) {
+        packed |= static_cast<uint8_t>(block[byte * 8 + bit] << bit);
+      }
+      dst[begin / 8 + byte] = packed;
+    }
+    for (size_t i = 0; i < rows; ++i) {
+      set += block[i];
+    }
+  }
+  return set;
+}
+} // namespace xarrow
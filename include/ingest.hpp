@@ -0,0 +1,211 @@
+/**
+ * @file ingest.hpp
+ * @brief Batched row to column ingestion of plain structs
+ *
+ * A RowLayout lists member pointers of a row struct plus the column names,
+ * all known at compile time:
+ *
+ *   constexpr auto layout = row_layout(field<&Trade::id>("id"),
+ *                                      field<&Trade::price>("price"));
+ *   RowIngestor ingestor(layout);
+ *   ingestor.append(rows.data(), rows.size());
+ *   auto [id, price] = ingestor.finish();
+ *
+ * append grows every column once per batch without initializing the new
+ * rows, then transposes into them in blocks that fit in L1, one strided copy
+ * loop per member and block. The ingestor copies the names and formats, so
+ * the layout may be built from temporary strings.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "common.hpp"
+#include "data_types.hpp"
+#include "xarrow.hpp"
+#include <array>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace xarrow {
+namespace detail {
+template <class M> struct member_traits;
+template <class C, class T> struct member_traits<T C::*> {
+  using class_type = C;
+  using value_type = T;
+};
+
+template <auto Member>
+using member_class_t = typename member_traits<decltype(Member)>::class_type;
+template <auto Member>
+using member_value_t = typename member_traits<decltype(Member)>::value_type;
+} // namespace detail
+
+/**
+ * @brief name and format of one column
+ * format is required for parameterized types, e.g. "tsn:UTC".
+ */
+struct FieldSpec {
+  std::string_view name;
+  std::string_view format{};
+};
+
+// FieldSpec bound to a member pointer, see field()
+template <auto Member> struct Field {
+  FieldSpec spec;
+};
+
+template <auto Member>
+constexpr auto field(std::string_view const name,
+                     std::string_view const format = {}) -> Field<Member> {
+  return {{name, format}};
+}
+
+template <class Row, auto... Members> struct RowLayout {
+  static_assert(sizeof...(Members) > 0, "a row layout needs a column");
+  static_assert((std::is_same_v<detail::member_class_t<Members>, Row> && ...),
+                "all members must belong to the same row type");
+
+  constexpr static size_t num_columns = sizeof...(Members);
+  std::array<FieldSpec, num_columns> fields;
+};
+
+template <auto First, auto... Rest>
+constexpr auto row_layout(Field<First> const first, Field<Rest> const... rest)
+    -> RowLayout<detail::member_class_t<First>, First, Rest...> {
+  return {{first.spec, rest.spec...}};
+}
+
+/**
+ * @brief appends batches of rows into one AlignedVector per layout member
+ */
+template <class Row, auto... Members> class RowIngestor {
+public:
+  // rows per transpose block, about 16 KiB of input
+  constexpr static size_t block_rows =
+      std::max<size_t>(1, (size_t{16} << 10) / sizeof(Row));
+
+  /**
+   * @brief throws std::invalid_argument on a missing or mismatched format
+   * Checked up front, so finish() cannot fail halfway through the columns.
+   */
+  explicit RowIngestor(RowLayout<Row, Members...> const &layout) {
+    for (size_t i = 0; i < layout.fields.size(); ++i) {
+      names_[i] = std::string(layout.fields[i].name);
+      formats_[i] = std::string(layout.fields[i].format);
+    }
+    check_formats(std::index_sequence_for<decltype(Members)...>{});
+  }
+
+  void append(Row const *rows, size_t const n) {
+    auto const old = size_;
+    try {
+      resize_columns(old + n);
+    } catch (...) {
+      // a column that grew before another failed must not keep the rows
+      resize_columns(old);
+      throw;
+    }
+    for (size_t begin = 0; begin < n; begin += block_rows) {
+      auto const end = std::min(n, begin + block_rows);
+      transpose(rows, old, begin, end,
+                std::index_sequence_for<decltype(Members)...>{});
+    }
+    size_ = old + n;
+  }
+  void append(std::vector<Row> const &rows) {
+    append(rows.data(), rows.size());
+  }
+
+  [[nodiscard]] auto size() const noexcept -> size_t { return size_; }
+  // column names and formats, copied from the layout
+  auto names() const noexcept
+      -> std::array<std::string, sizeof...(Members)> const & {
+    return names_;
+  }
+  auto formats() const noexcept
+      -> std::array<std::string, sizeof...(Members)> const & {
+    return formats_;
+  }
+  template <size_t I> auto column() const noexcept -> auto const & {
+    return std::get<I>(columns_);
+  }
+
+  /**
+   * @brief move the columns out as named XArrowNonNull, in layout order
+   * The ingestor is left empty afterwards.
+   */
+  auto finish()
+      -> std::tuple<XArrowNonNull<detail::member_value_t<Members>>...> {
+    auto result = finish(std::index_sequence_for<decltype(Members)...>{});
+    size_ = 0;
+    return result;
+  }
+
+private:
+  // the new rows are left uninitialized, the transpose overwrites them
+  void resize_columns(size_t const rows) {
+    std::apply(
+        [rows](auto &...columns) {
+          (columns.resize_uninitialized(rows), ...);
+        },
+        columns_);
+  }
+
+  template <auto Member, class T>
+  static void copy_member(T *dst, Row const *rows, size_t const begin,
+                          size_t const end) noexcept {
+    for (size_t i = begin; i < end; ++i) {
+      dst[i] = rows[i].*Member;
+    }
+  }
+
+  template <size_t... I>
+  void transpose(Row const *rows, size_t const old, size_t const begin,
+                 size_t const end, std::index_sequence<I...> /*unused*/) {
+    (copy_member<Members>(std::get<I>(columns_).data() + old, rows, begin,
+                          end),
+     ...);
+  }
+
+  template <size_t I, auto Member> void check_format() const {
+    using T = detail::member_value_t<Member>;
+    if (!formats_[I].empty()) {
+      static_cast<void>(detail::checked_format<T>(formats_[I]));
+    } else if constexpr (is_parameterized_v<T>) {
+      throw std::invalid_argument("RowIngestor: parameterized column " +
+                                  names_[I] + " needs a format");
+    }
+  }
+
+  template <size_t... I>
+  void check_formats(std::index_sequence<I...> /*unused*/) const {
+    (check_format<I, Members>(), ...);
+  }
+
+  template <size_t I, auto Member> auto make_column() {
+    using T = detail::member_value_t<Member>;
+    auto data = std::move(std::get<I>(columns_));
+    std::get<I>(columns_) = AlignedVector<T, alignment>();
+    if constexpr (!is_parameterized_v<T>) {
+      if (formats_[I].empty()) {
+        return XArrowNonNull<T>(names_[I], std::move(data));
+      }
+    }
+    // the constructor already checked the format
+    return XArrowNonNull<T>(names_[I], formats_[I], std::move(data));
+  }
+
+  template <size_t... I>
+  auto finish(std::index_sequence<I...> /*unused*/)
+      -> std::tuple<XArrowNonNull<detail::member_value_t<Members>>...> {
+    return {make_column<I, Members>()...};
+  }
+
+  // owned, the layout may view strings that die before the ingestor
+  std::array<std::string, sizeof...(Members)> names_;
+  std::array<std::string, sizeof...(Members)> formats_;
+  std::tuple<AlignedVector<detail::member_value_t<Members>, alignment>...>
+      columns_;
+  size_t size_ = 0;
+};
+} // namespace xarrow
@@ -0,0 +1,313 @@
+/**
+ * @file kernels.hpp
+ * @brief Kernels over decimal, temporal and embedding columns
+ *
+ * Span kernels are branch-free loops the compiler can unroll and vectorize;
+ * the column overloads check formats and lengths, then call them.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "common.hpp"
+#include "logical_types.hpp"
+#include "nested.hpp"
+#include "xarrow.hpp"
+
+namespace xarrow {
+namespace detail {
+__extension__ using uint128_t = unsigned __int128;
+
+inline auto to_uint128(Decimal128 const &v) noexcept -> uint128_t {
+  return (static_cast<uint128_t>(static_cast<uint64_t>(v.high)) << 64) | v.low;
+}
+
+template <class T>
+void check_same_length(XArrowNonNull<T> const &lhs,
+                       XArrowNonNull<T> const &rhs) {
+  if (lhs.data().size() != rhs.data().size()) {
+    throw std::invalid_argument("kernel: column lengths differ");
+  }
+}
+} // namespace detail
+
+/**
+ * @brief out = lhs + rhs, wrapping on overflow of the 128-bit range
+ */
+inline void decimal128_add(Decimal128 const *lhs, Decimal128 const *rhs,
+                           Decimal128 *out, size_t const n) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    auto const low = lhs[i].low + rhs[i].low;
+    uint64_t const carry = low < lhs[i].low ? 1 : 0;
+    auto const high = static_cast<uint64_t>(lhs[i].high) +
+                      static_cast<uint64_t>(rhs[i].high) + carry;
+    out[i] = {low, static_cast<int64_t>(high)};
+  }
+}
+
+/**
+ * @brief out = lhs - rhs, wrapping on overflow of the 128-bit range
+ */
+inline void decimal128_subtract(Decimal128 const *lhs, Decimal128 const *rhs,
+                                Decimal128 *out, size_t const n) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    auto const low = lhs[i].low - rhs[i].low;
+    uint64_t const borrow = lhs[i].low < rhs[i].low ? 1 : 0;
+    auto const high = static_cast<uint64_t>(lhs[i].high) -
+                      static_cast<uint64_t>(rhs[i].high) - borrow;
+    out[i] = {low, static_cast<int64_t>(high)};
+  }
+}
+
+/**
+ * @brief out = lhs * rhs, the result scale is the sum of both scales
+ * Wraps on overflow of the 128-bit range.
+ */
+inline void decimal128_multiply(Decimal128 const *lhs, Decimal128 const *rhs,
+                                Decimal128 *out, size_t const n) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    // two's complement product is sign agnostic modulo 2^128
+    auto const product =
+        detail::to_uint128(lhs[i]) * detail::to_uint128(rhs[i]);
+    out[i] = {static_cast<uint64_t>(product),
+              static_cast<int64_t>(static_cast<uint64_t>(product >> 64))};
+  }
+}
+
+enum class CompareOp : uint8_t { EQ, NE, LT, LE, GT, GE };
+
+namespace detail {
+template <CompareOp Op>
+void decimal128_compare(Decimal128 const *lhs, Decimal128 const *rhs,
+                        bool *out, size_t const n) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    auto const eq = lhs[i].high == rhs[i].high && lhs[i].low == rhs[i].low;
+    auto const lt = lhs[i].high < rhs[i].high ||
+                    (lhs[i].high == rhs[i].high && lhs[i].low < rhs[i].low);
+    if constexpr (Op == CompareOp::EQ) {
+      out[i] = eq;
+    } else if constexpr (Op == CompareOp::NE) {
+      out[i] = !eq;
+    } else if constexpr (Op == CompareOp::LT) {
+      out[i] = lt;
+    } else if constexpr (Op == CompareOp::LE) {
+      out[i] = lt || eq;
+    } else if constexpr (Op == CompareOp::GT) {
+      out[i] = !lt && !eq;
+    } else {
+      out[i] = !lt;
+    }
+  }
+}
+} // namespace detail
+
+/**
+ * @brief out[i] = lhs[i] op rhs[i], both sides must share the scale
+ */
+inline void decimal128_compare(Decimal128 const *lhs, Decimal128 const *rhs,
+                               bool *out, size_t const n, CompareOp const op) {
+  switch (op) {
+  case CompareOp::EQ:
+    return detail::decimal128_compare<CompareOp::EQ>(lhs, rhs, out, n);
+  case CompareOp::NE:
+    return detail::decimal128_compare<CompareOp::NE>(lhs, rhs, out, n);
+  case CompareOp::LT:
+    return detail::decimal128_compare<CompareOp::LT>(lhs, rhs, out, n);
+  case CompareOp::LE:
+    return detail::decimal128_compare<CompareOp::LE>(lhs, rhs, out, n);
+  case CompareOp::GT:
+    return detail::decimal128_compare<CompareOp::GT>(lhs, rhs, out, n);
+  case CompareOp::GE:
+    return detail::decimal128_compare<CompareOp::GE>(lhs, rhs, out, n);
+  default:
+    throw std::runtime_error("Unsupported CompareOp");
+  }
+}
+
+namespace detail {
+template <class Kernel>
+auto decimal128_binary(XArrowNonNull<Decimal128> const &lhs,
+                       XArrowNonNull<Decimal128> const &rhs,
+                       std::string_view const name, std::string format,
+                       Kernel kernel) -> XArrowNonNull<Decimal128> {
+  check_same_length(lhs, rhs);
+  AlignedVector<Decimal128, alignment> out(lhs.data().size());
+  metrics::KernelTimer const timer(out.size());
+  kernel(lhs.data().data(), rhs.data().data(), out.data(), out.size());
+  return {name, std::move(format), std::move(out)};
+}
+
+// result of add/subtract: one more digit than the wider side, same scale
+inline auto sum_decimal_format(XArrowNonNull<Decimal128> const &lhs,
+                               XArrowNonNull<Decimal128> const &rhs)
+    -> std::string {
+  auto const l = parse_decimal_format(lhs.type_format());
+  auto const r = parse_decimal_format(rhs.type_format());
+  if (l.scale != r.scale) {
+    throw std::invalid_argument("kernel: decimal scales differ");
+  }
+  return decimal_format(
+      {std::min(std::max(l.precision, r.precision) + 1, 38), l.scale, 128});
+}
+} // namespace detail
+
+/**
+ * @brief scales must match, precision grows to max(p1, p2) + 1 (capped at 38)
+ */
+inline auto decimal128_add(XArrowNonNull<Decimal128> const &lhs,
+                           XArrowNonNull<Decimal128> const &rhs,
+                           std::string_view const name)
+    -> XArrowNonNull<Decimal128> {
+  return detail::decimal128_binary(lhs, rhs, name,
+                                   detail::sum_decimal_format(lhs, rhs),
+                                   [](auto... args) {
+                                     decimal128_add(args...);
+                                   });
+}
+
+/**
+ * @brief same result format as decimal128_add
+ */
+inline auto decimal128_subtract(XArrowNonNull<Decimal128> const &lhs,
+                                XArrowNonNull<Decimal128> const &rhs,
+                                std::string_view const name)
+    -> XArrowNonNull<Decimal128> {
+  return detail::decimal128_binary(lhs, rhs, name,
+                                   detail::sum_decimal_format(lhs, rhs),
+                                   [](auto... args) {
+                                     decimal128_subtract(args...);
+                                   });
+}
+
+/**
+ * @brief precision grows to p1 + p2 + 1 (capped at 38), scale to s1 + s2
+ */
+inline auto decimal128_multiply(XArrowNonNull<Decimal128> const &lhs,
+                                XArrowNonNull<Decimal128> const &rhs,
+                                std::string_view const name)
+    -> XArrowNonNull<Decimal128> {
+  auto const l = parse_decimal_format(lhs.type_format());
+  auto const r = parse_decimal_format(rhs.type_format());
+  auto const format = decimal_format(
+      {std::min(l.precision + r.precision + 1, 38), l.scale + r.scale, 128});
+  return detail::decimal128_binary(lhs, rhs, name, format, [](auto... args) {
+    decimal128_multiply(args...);
+  });
+}
+
+inline auto decimal128_compare(XArrowNonNull<Decimal128> const &lhs,
+                               XArrowNonNull<Decimal128> const &rhs,
+                               CompareOp const op, std::string_view const name)
+    -> XArrowNonNull<bool> {
+  detail::check_same_length(lhs, rhs);
+  detail::sum_decimal_format(lhs, rhs);
+  AlignedVector<bool, alignment> out(lhs.data().size());
+  metrics::KernelTimer const timer(out.size());
+  decimal128_compare(lhs.data().data(), rhs.data().data(), out.data(),
+                     out.size(), op);
+  return {name, std::move(out)};
+}
+
+enum class TimeGranularity : uint8_t { SECOND, MINUTE, HOUR, DAY };
+
+namespace detail {
+// compile-time divisor so the division becomes a multiply and shift
+template <int64_t Divisor>
+void floor_ticks(Timestamp const *in, Timestamp *out, size_t const n) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    auto const v = in[i].value;
+    auto const r = v % Divisor;
+    // round towards negative infinity for instants before the epoch
+    out[i].value = v - r - (r < 0 ? Divisor : 0);
+  }
+}
+
+template <int64_t TicksPerSecond>
+void truncate_ticks(Timestamp const *in, Timestamp *out, size_t const n,
+                    TimeGranularity const to) {
+  switch (to) {
+  case TimeGranularity::SECOND:
+    return floor_ticks<TicksPerSecond>(in, out, n);
+  case TimeGranularity::MINUTE:
+    return floor_ticks<TicksPerSecond * 60>(in, out, n);
+  case TimeGranularity::HOUR:
+    return floor_ticks<TicksPerSecond * 3600>(in, out, n);
+  case TimeGranularity::DAY:
+    return floor_ticks<TicksPerSecond * 86400>(in, out, n);
+  default:
+    throw std::runtime_error("Unsupported TimeGranularity");
+  }
+}
+} // namespace detail
+
+/**
+ * @brief floor each timestamp to a multiple of the granularity
+ * Boundaries are taken on the UTC instant, so DAY truncation yields UTC
+ * midnights regardless of the column's timezone.
+ */
+inline void timestamp_truncate(Timestamp const *in, Timestamp *out,
+                               size_t const n, TimeUnit const unit,
+                               TimeGranularity const to) {
+  switch (unit) {
+  case TimeUnit::SECOND:
+    return detail::truncate_ticks<1>(in, out, n, to);
+  case TimeUnit::MILLI:
+    return detail::truncate_ticks<1000>(in, out, n, to);
+  case TimeUnit::MICRO:
+    return detail::truncate_ticks<1000 * 1000>(in, out, n, to);
+  case TimeUnit::NANO:
+    return detail::truncate_ticks<1000 * 1000 * 1000>(in, out, n, to);
+  default:
+    throw std::runtime_error("Unsupported TimeUnit");
+  }
+}
+
+inline auto timestamp_truncate(XArrowNonNull<Timestamp> const &in,
+                               TimeGranularity const to,
+                               std::string_view const name)
+    -> XArrowNonNull<Timestamp> {
+  AlignedVector<Timestamp, alignment> out(in.data().size());
+  metrics::KernelTimer const timer(out.size());
+  timestamp_truncate(in.data().data(), out.data(), out.size(),
+                     time_unit_of(in.type_format()), to);
+  return {name, in.type_format(), std::move(out)};
+}
+
+/**
+ * @brief squared euclidean distance between two float vectors of length n
+ * Partial sums run in independent lanes so the loop vectorizes without
+ * reassociating float adds.
+ */
+inline auto l2_squared(float const *lhs, float const *rhs,
+                       size_t const n) noexcept -> float {
+  constexpr size_t lanes = 16;
+  std::array<float, lanes> acc{};
+  size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    for (size_t l = 0; l < lanes; ++l) {
+      auto const d = lhs[i + l] - rhs[i + l];
+      acc[l] += d * d;
+    }
+  }
+  float sum = 0;
+  for (; i < n; ++i) {
+    auto const d = lhs[i] - rhs[i];
+    sum += d * d;
+  }
+  for (auto const a : acc) {
+    sum += a;
+  }
+  return sum;
+}
+
+/**
+ * @brief out[r] = squared distance between row r and query, out holds size()
+ */
+template <size_t N>
+void l2_squared(XArrowFixedSizeList<float, N> const &rows, float const *query,
+                float *out) noexcept {
+  metrics::KernelTimer const timer(rows.size());
+  auto const *values = rows.values().data();
+  for (size_t r = 0; r < rows.size(); ++r) {
+    out[r] = l2_squared(values + r * N, query, N);
+  }
+}
+} // namespace xarrow
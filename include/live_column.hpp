@@ -0,0 +1,159 @@
+/**
+ * @file live_column.hpp
+ * @brief Column appended by one writer while other threads export it
+ *
+ * Storage is a list of fixed-size segments that never move once allocated,
+ * so readers never race with a reallocation. The writer fills rows past the
+ * published length, then publishes the new length with release semantics;
+ * readers load it with acquire semantics and only look at rows below it.
+ * Neither side takes a lock.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "arrow.hpp"
+#include "common.hpp"
+#include "data_types.hpp"
+#include "xarrow.hpp"
+#include <atomic>
+#include <string>
+#include <string_view>
+
+namespace xarrow {
+template <class T> class LiveColumn {
+public:
+  constexpr static size_t default_segment_rows = size_t{1} << 16;
+  constexpr static size_t default_max_segments = 4096;
+
+  explicit LiveColumn(std::string_view name,
+                      size_t const segment_rows = default_segment_rows,
+                      size_t const max_segments = default_max_segments)
+      : LiveColumn(name, type2format<T>(), segment_rows, max_segments, 0) {
+    static_assert(!is_parameterized_v<T>,
+                  "parameterized types need an explicit format");
+  }
+  /**
+   * @brief column with a full format, e.g. "tsn:UTC"
+   */
+  LiveColumn(std::string_view name, std::string format,
+             size_t const segment_rows = default_segment_rows,
+             size_t const max_segments = default_max_segments)
+      : LiveColumn(name, detail::checked_format<T>(std::move(format)),
+                   segment_rows, max_segments, 0) {}
+
+  // readers hold references to the column
+  LiveColumn(LiveColumn const &) = delete;
+  auto operator=(LiveColumn const &) -> LiveColumn & = delete;
+  LiveColumn(LiveColumn &&) = delete;
+  auto operator=(LiveColumn &&) -> LiveColumn & = delete;
+  ~LiveColumn() = default;
+
+  /**
+   * @brief writer only, visible to readers once it returns
+   */
+  void push_back(T const value) {
+    auto const n = length_.load(std::memory_order_relaxed);
+    segment_for(n)[n % segment_rows_] = value;
+    length_.store(n + 1, std::memory_order_release);
+  }
+  /**
+   * @brief writer only, the whole batch becomes visible at once
+   * Throws std::length_error, publishing nothing, when the segments run out.
+   */
+  void append(T const *values, size_t count) {
+    auto const n = length_.load(std::memory_order_relaxed);
+    if (count > capacity() - n) {
+      throw std::length_error("LiveColumn: out of segments");
+    }
+    auto pos = n;
+    while (count > 0) {
+      auto const in_segment = pos % segment_rows_;
+      auto const take = std::min(count, segment_rows_ - in_segment);
+      std::memcpy(segment_for(pos) + in_segment, values, take * sizeof(T));
+      values += take;
+      pos += take;
+      count -= take;
+    }
+    length_.store(pos, std::memory_order_release);
+  }
+
+  auto name() const noexcept -> std::string_view { return name_; }
+  [[nodiscard]] auto type_format() const noexcept -> std::string const & {
+    return format_;
+  }
+  /**
+   * @brief published length, safe from any thread
+   */
+  [[nodiscard]] auto size() const noexcept -> size_t {
+    return length_.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] auto capacity() const noexcept -> size_t {
+    return segment_rows_ * max_segments_;
+  }
+  [[nodiscard]] auto segment_rows() const noexcept -> size_t {
+    return segment_rows_;
+  }
+
+  /**
+   * @brief consistent zero-copy view of the published rows, safe from any
+   * thread and never blocking the writer
+   * The snapshot shares the segments, so it outlives the column.
+   */
+  [[nodiscard]] auto snapshot() const -> ChunkedColumn<T> {
+    auto const n = size();
+    ChunkedColumn<T> result(name_, format_);
+    for (size_t i = 0; i * segment_rows_ < n; ++i) {
+      auto const rows = std::min(segment_rows_, n - i * segment_rows_);
+      result.append(XArrowSlice<T>(name_, format_, segments_[i], 0, rows));
+    }
+    return result;
+  }
+
+  void to_schema_move(ArrowSchema &schema) const {
+    detail::schema_move(schema, format_, name_);
+  }
+  /**
+   * @brief export a snapshot as a stream of one array per segment
+   */
+  void to_stream_move(ArrowArrayStream &stream) const {
+    snapshot().to_stream_move(stream);
+  }
+
+private:
+  LiveColumn(std::string_view name, std::string format,
+             size_t const segment_rows, size_t const max_segments,
+             int /*unused*/)
+      : name_(name), format_(std::move(format)), segment_rows_(segment_rows),
+        max_segments_(max_segments),
+        segments_(std::make_unique<Segment[]>(max_segments)) {
+    if (segment_rows == 0 || max_segments == 0) {
+      throw std::invalid_argument("LiveColumn: empty segment layout");
+    }
+  }
+
+  using Segment = std::shared_ptr<AlignedVector<T, alignment>>;
+
+  // writer only; a new segment is published along with the length
+  auto segment_for(size_t const pos) -> T * {
+    auto const index = pos / segment_rows_;
+    if (index == allocated_) {
+      if (index == max_segments_) {
+        throw std::length_error("LiveColumn: out of segments");
+      }
+      segments_[index] =
+          std::make_shared<AlignedVector<T, alignment>>(segment_rows_);
+      ++allocated_;
+    }
+    // rows past the published length belong to the writer alone
+    return segments_[index]->data();
+  }
+
+  std::string name_;
+  std::string format_;
+  size_t segment_rows_;
+  size_t max_segments_;
+  std::unique_ptr<Segment[]> segments_;
+  // touched by the writer only
+  size_t allocated_ = 0;
+  std::atomic<size_t> length_{0};
+};
+} // namespace xarrow
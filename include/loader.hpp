@@ -0,0 +1,101 @@
+/**
+ * @file loader.hpp
+ * @brief Pipelined column loaders for raw binary and CSV files
+ *
+ * Files are read in large aligned chunks with several reads kept in flight,
+ * either through io_uring or a pool of pread threads, while the calling
+ * thread decodes completed chunks in file order.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "common.hpp"
+#include "data_types.hpp"
+#include "xarrow.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace xarrow {
+// O_DIRECT needs block aligned buffers, offsets and lengths
+constexpr static size_t direct_alignment = 4096;
+
+enum class IoBackend : uint8_t { AUTO, IO_URING, THREADS };
+
+struct LoadOptions {
+  // rounded up to direct_alignment
+  size_t chunk_bytes = size_t{4} << 20;
+  // reads kept in flight ahead of the decoder
+  size_t queue_depth = 4;
+  // bypass the page cache, silently dropped where unsupported
+  bool direct = false;
+  IoBackend backend = IoBackend::AUTO;
+};
+
+using ChunkCallback = std::function<void(const std::byte *data, size_t size)>;
+
+/**
+ * @brief read path sequentially, calling on_chunk for each chunk in order
+ * AUTO tries io_uring and falls back to threads when the kernel refuses.
+ * @return the backend actually used
+ */
+auto read_chunks(const char *path, LoadOptions const &options,
+                 ChunkCallback const &on_chunk) -> IoBackend;
+
+/**
+ * @brief read the first size bytes of path straight into dst, pipelined
+ * like read_chunks
+ * dst needs room for size rounded up to direct_alignment. O_DIRECT is only
+ * used when dst is direct_alignment aligned.
+ * @return bytes read, fewer than size when the file is shorter
+ */
+auto read_into(const char *path, std::byte *dst, size_t size,
+               LoadOptions const &options = {}) -> size_t;
+
+[[nodiscard]] auto file_size(const char *path) -> size_t;
+
+/**
+ * @brief load a flat native-endian array of T into a column
+ */
+template <class T>
+auto load_binary(const char *path, std::string_view name,
+                 LoadOptions const &options = {}) -> XArrowNonNull<T> {
+  auto const bytes = file_size(path);
+  if (bytes % sizeof(T) != 0) {
+    throw std::runtime_error("load_binary: size is not a multiple of T");
+  }
+  AlignedVector<T, alignment> data;
+  // the reads land in the column itself, block rounded for O_DIRECT
+  auto const room = align_round(bytes, direct_alignment);
+  data.reserve_aligned((room + sizeof(T) - 1) / sizeof(T), direct_alignment);
+  auto *dst = reinterpret_cast<std::byte *>(data.data()); // NOLINT
+  if (read_into(path, dst, bytes, options) != bytes) [[unlikely]] {
+    throw std::runtime_error("load_binary: file shrank while loading");
+  }
+  data.resize_uninitialized(bytes / sizeof(T));
+  return XArrowNonNull<T>(name, std::move(data));
+}
+
+struct CsvColumn {
+  std::string name;
+  Type type;
+  // full format for parameterized types, e.g. "tsm:UTC"
+  std::string format{};
+};
+
+struct CsvOptions {
+  char delimiter = ',';
+  // skip the first line
+  bool header = true;
+};
+
+/**
+ * @brief parse a numeric CSV file into one column per CsvColumn
+ * Fields are decoded with std::from_chars straight into the columns, bool
+ * accepts 0/1/true/false. Temporal columns take integer counts in their
+ * unit, DATE32 also YYYY-MM-DD; decimal columns are not supported.
+ * Throws std::runtime_error on malformed lines.
+ */
+auto load_csv(const char *path, std::vector<CsvColumn> const &columns,
+              CsvOptions const &csv = {}, LoadOptions const &options = {})
+    -> std::vector<XArrowVariant>;
+} // namespace xarrow
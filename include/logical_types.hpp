@@ -0,0 +1,252 @@
+/**
+ * @file logical_types.hpp
+ * @brief Storage types for decimal and temporal columns
+ *
+ * Each type wraps its physical Arrow representation so that columns keep
+ * their semantics instead of degrading to bare integers. Parameters such as
+ * time unit, timezone, precision and scale live in the column's format
+ * string, see timestamp_format, duration_format and decimal_format.
+ */
+#pragma once
+#include "common.hpp"
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace xarrow {
+// days since the UNIX epoch
+struct Date32 {
+  int32_t value;
+};
+// milliseconds since the UNIX epoch
+struct Date64 {
+  int64_t value;
+};
+// time since the UNIX epoch (UTC) in the column's unit
+struct Timestamp {
+  int64_t value;
+};
+// elapsed time in the column's unit
+struct Duration {
+  int64_t value;
+};
+// 128-bit two's complement, little-endian as laid out by Arrow
+struct Decimal128 {
+  uint64_t low;
+  int64_t high;
+
+  constexpr static auto from_int64(int64_t const v) noexcept -> Decimal128 {
+    return {static_cast<uint64_t>(v), v < 0 ? -1 : 0};
+  }
+};
+// 256-bit two's complement, least significant word first
+struct Decimal256 {
+  std::array<uint64_t, 4> words;
+};
+
+#define XARROW_VALUE_EQUALITY(type, member)                                    \
+  inline auto operator==(type const &lhs, type const &rhs) noexcept -> bool {  \
+    return lhs.member == rhs.member;                                           \
+  }                                                                            \
+  inline auto operator!=(type const &lhs, type const &rhs) noexcept -> bool {  \
+    return !(lhs == rhs);                                                      \
+  }
+XARROW_VALUE_EQUALITY(Date32, value)
+XARROW_VALUE_EQUALITY(Date64, value)
+XARROW_VALUE_EQUALITY(Timestamp, value)
+XARROW_VALUE_EQUALITY(Duration, value)
+XARROW_VALUE_EQUALITY(Decimal256, words)
+#undef XARROW_VALUE_EQUALITY
+
+#define XARROW_VALUE_ORDER(type)                                               \
+  constexpr auto operator<(type const &lhs, type const &rhs) noexcept          \
+      -> bool {                                                                \
+    return lhs.value < rhs.value;                                              \
+  }
+XARROW_VALUE_ORDER(Date32)
+XARROW_VALUE_ORDER(Date64)
+XARROW_VALUE_ORDER(Timestamp)
+XARROW_VALUE_ORDER(Duration)
+#undef XARROW_VALUE_ORDER
+
+constexpr auto operator==(Decimal128 const &lhs, Decimal128 const &rhs) noexcept
+    -> bool {
+  return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+constexpr auto operator!=(Decimal128 const &lhs, Decimal128 const &rhs) noexcept
+    -> bool {
+  return !(lhs == rhs);
+}
+constexpr auto operator<(Decimal128 const &lhs, Decimal128 const &rhs) noexcept
+    -> bool {
+  return lhs.high < rhs.high || (lhs.high == rhs.high && lhs.low < rhs.low);
+}
+
+/**
+ * @brief types whose Arrow format carries per-column parameters
+ */
+template <class T>
+constexpr static bool is_parameterized_v =
+    std::is_same_v<T, Timestamp> || std::is_same_v<T, Duration> ||
+    std::is_same_v<T, Decimal128> || std::is_same_v<T, Decimal256>;
+
+/**
+ * @brief days since the UNIX epoch of a proleptic Gregorian date
+ */
+constexpr static auto days_from_civil(int64_t year, unsigned const month,
+                                      unsigned const day) noexcept
+    -> int64_t {
+  year -= month <= 2 ? 1 : 0;
+  auto const era = (year >= 0 ? year : year - 399) / 400;
+  auto const yoe = static_cast<unsigned>(year - era * 400);
+  auto const mp = month > 2 ? month - 3 : month + 9;
+  auto const doy = (153 * mp + 2) / 5 + day - 1;
+  auto const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+enum class TimeUnit : uint8_t { SECOND, MILLI, MICRO, NANO };
+
+constexpr static auto time_unit_char(TimeUnit const unit) -> char {
+  switch (unit) {
+  case TimeUnit::SECOND:
+    return 's';
+  case TimeUnit::MILLI:
+    return 'm';
+  case TimeUnit::MICRO:
+    return 'u';
+  case TimeUnit::NANO:
+    return 'n';
+  default:
+    throw std::runtime_error("Unsupported TimeUnit");
+  }
+}
+
+constexpr static auto time_unit_from_char(char const c) -> TimeUnit {
+  switch (c) {
+  case 's':
+    return TimeUnit::SECOND;
+  case 'm':
+    return TimeUnit::MILLI;
+  case 'u':
+    return TimeUnit::MICRO;
+  case 'n':
+    return TimeUnit::NANO;
+  default:
+    throw std::runtime_error("Unsupported time unit");
+  }
+}
+
+constexpr static auto ticks_per_second(TimeUnit const unit) -> int64_t {
+  switch (unit) {
+  case TimeUnit::SECOND:
+    return 1;
+  case TimeUnit::MILLI:
+    return 1000;
+  case TimeUnit::MICRO:
+    return 1000 * 1000;
+  case TimeUnit::NANO:
+    return 1000 * 1000 * 1000;
+  default:
+    throw std::runtime_error("Unsupported TimeUnit");
+  }
+}
+
+/**
+ * @brief e.g. "tsn:UTC", an empty timezone means naive local time
+ */
+inline auto timestamp_format(TimeUnit const unit,
+                             std::string_view const timezone = {})
+    -> std::string {
+  std::string format = "ts";
+  format += time_unit_char(unit);
+  format += ':';
+  format += timezone;
+  return format;
+}
+
+inline auto duration_format(TimeUnit const unit) -> std::string {
+  std::string format = "tD";
+  format += time_unit_char(unit);
+  return format;
+}
+
+/**
+ * @brief unit of a "ts?:..." or "tD?" format
+ */
+inline auto time_unit_of(std::string_view const format) -> TimeUnit {
+  if (format.size() < 3 || format[0] != 't' ||
+      (format[1] != 's' && format[1] != 'D')) {
+    throw std::runtime_error("Not a timestamp or duration format");
+  }
+  return time_unit_from_char(format[2]);
+}
+
+struct DecimalParams {
+  int precision;
+  int scale;
+  int bit_width;
+};
+
+/**
+ * @brief "d:precision,scale", with ",256" appended for Decimal256
+ */
+inline auto decimal_format(DecimalParams const params) -> std::string {
+  auto const max_precision = params.bit_width == 128   ? 38
+                             : params.bit_width == 256 ? 76
+                                                       : 0;
+  if (params.precision < 1 || params.precision > max_precision) {
+    throw std::invalid_argument("decimal_format: bad precision or width");
+  }
+  auto format = "d:" + std::to_string(params.precision) + "," +
+                std::to_string(params.scale);
+  if (params.bit_width != 128) {
+    format += "," + std::to_string(params.bit_width);
+  }
+  return format;
+}
+
+inline auto parse_decimal_format(std::string_view const format)
+    -> DecimalParams {
+  if (format.size() < 5 || format.substr(0, 2) != "d:") {
+    throw std::runtime_error("Not a decimal format");
+  }
+  DecimalParams params{0, 0, 128};
+  std::array<int *, 3> fields{&params.precision, &params.scale,
+                              &params.bit_width};
+  size_t field = 0;
+  bool negative = false;
+  bool seen_digit = false;
+  for (auto const c : format.substr(2)) {
+    if (c == ',') {
+      if (!seen_digit || ++field == fields.size()) {
+        throw std::runtime_error("Malformed decimal format");
+      }
+      *fields[field] = 0;
+      negative = seen_digit = false;
+    } else if (c == '-' && !seen_digit && !negative) {
+      negative = true;
+    } else if (c >= '0' && c <= '9') {
+      auto &value = *fields[field];
+      auto const digit = c - '0';
+      // a field that does not fit an int is no decimal format either
+      if (negative ? value < (std::numeric_limits<int>::min() + digit) / 10
+                   : value > (std::numeric_limits<int>::max() - digit) / 10) {
+        throw std::runtime_error("Malformed decimal format");
+      }
+      value = value * 10 + (negative ? -digit : digit);
+      seen_digit = true;
+    } else {
+      throw std::runtime_error("Malformed decimal format");
+    }
+  }
+  if (field == 0 || !seen_digit) {
+    throw std::runtime_error("Malformed decimal format");
+  }
+  // Decimal128 and Decimal256 are the only widths with a value type here
+  if (params.bit_width != 128 && params.bit_width != 256) {
+    throw std::runtime_error("Unsupported decimal bit width");
+  }
+  return params;
+}
+} // namespace xarrow
@@ -0,0 +1,223 @@
+/**
+ * @file metrics.hpp
+ * @brief Process-wide counters for allocations, exports and kernels
+ *
+ * Each thread bumps its own relaxed atomic counters, so recording is a plain
+ * load and store on a thread-local cache line; metrics::snapshot() sums all
+ * threads, including ones that already exited.
+ *
+ * Build with XARROW_METRICS=0 to compile every hook out. No layout depends
+ * on it and the hooks live in an inline namespace named after it, so
+ * translation units built either way link safely; shared templates such as
+ * AlignedBuffer then count only if the linker keeps an instrumented copy.
+ */
+#pragma once
+#include "common.hpp"
+#include <atomic>
+#include <chrono>
+
+#ifndef XARROW_METRICS
+#define XARROW_METRICS 1
+#endif
+
+#if XARROW_METRICS
+#define XARROW_METRICS_HOOKS hooks_on
+#else
+#define XARROW_METRICS_HOOKS hooks_off
+#endif
+
+namespace xarrow {
+namespace metrics {
+// X(enum, name) for every counter
+#define XARROW_COUNTERS(X)                                                     \
+  X(BYTES_ALLOCATED, bytes_allocated)                                          \
+  X(BYTES_LIVE, bytes_live)                                                    \
+  X(ALLOCATIONS, allocations)                                                  \
+  X(REALLOC_BYTES_COPIED, realloc_bytes_copied)                                \
+  X(EXPORTS, exports)                                                          \
+  X(EXPORTS_OUTSTANDING, exports_outstanding)                                  \
+  X(KERNEL_CALLS, kernel_calls)                                                \
+  X(KERNEL_ROWS, kernel_rows)                                                  \
+  X(KERNEL_NS, kernel_ns)
+
+#define XARROW_COUNTER_ENUM(e, name) e,
+enum class Counter : uint8_t { XARROW_COUNTERS(XARROW_COUNTER_ENUM) };
+#undef XARROW_COUNTER_ENUM
+
+#define XARROW_COUNTER_ONE(e, name) +1
+constexpr static size_t counter_count = 0 XARROW_COUNTERS(XARROW_COUNTER_ONE);
+#undef XARROW_COUNTER_ONE
+
+// bucket i counts samples in [2^i, 2^(i+1)), bucket 0 also takes 0
+constexpr static size_t histogram_buckets = 48;
+using Histogram = std::array<uint64_t, histogram_buckets>;
+
+/**
+ * @brief exporter friendly name, e.g. "bytes_live"
+ */
+auto counter_name(Counter counter) -> const char *;
+
+struct Snapshot {
+  std::array<int64_t, counter_count> counters{};
+  // size of each AlignedBuffer allocation in bytes
+  Histogram allocation_bytes{};
+  // per kernel call, picoseconds per row
+  Histogram kernel_ps_per_row{};
+
+  auto operator[](Counter const counter) const noexcept -> int64_t {
+    return counters[static_cast<size_t>(counter)];
+  }
+  [[nodiscard]] auto kernel_ns_per_row() const noexcept -> double {
+    auto const rows = (*this)[Counter::KERNEL_ROWS];
+    return rows == 0 ? 0.0
+                     : static_cast<double>((*this)[Counter::KERNEL_NS]) /
+                           static_cast<double>(rows);
+  }
+};
+
+/**
+ * @brief current totals over all threads, all zero when compiled out
+ */
+auto snapshot() -> Snapshot;
+
+namespace detail {
+struct ThreadCounters {
+  std::array<std::atomic<int64_t>, counter_count> counters{};
+  std::array<std::atomic<uint64_t>, histogram_buckets> allocation_bytes{};
+  std::array<std::atomic<uint64_t>, histogram_buckets> kernel_ps_per_row{};
+  // written by several threads, see bump
+  bool shared = false;
+};
+
+// registers the thread's counters, folds them into the totals on exit
+struct ThreadSlot {
+  ThreadSlot();
+  ~ThreadSlot();
+  ThreadSlot(ThreadSlot const &) = delete;
+  auto operator=(ThreadSlot const &) -> ThreadSlot & = delete;
+  ThreadSlot(ThreadSlot &&) = delete;
+  auto operator=(ThreadSlot &&) -> ThreadSlot & = delete;
+
+  ThreadCounters *counters = nullptr;
+};
+
+// the live slot's counters; trivially destructible, so still readable
+// while statics and later thread_locals are destroyed
+inline thread_local ThreadCounters *thread_counters = nullptr;
+
+/**
+ * @brief first use creates the thread's slot; once the slot is gone, e.g.
+ * for a static column freed at exit, the shared totals of exited threads
+ */
+auto attach_thread() noexcept -> ThreadCounters &;
+
+inline auto local() noexcept -> ThreadCounters & {
+  auto *counters = thread_counters;
+  return counters != nullptr ? *counters : attach_thread();
+}
+
+// only the owning thread writes, so no read-modify-write is needed unless
+// the counters are shared
+template <class V>
+void bump(std::atomic<V> &cell, V const delta, bool const shared) noexcept {
+  if (shared) [[unlikely]] {
+    cell.fetch_add(delta, std::memory_order_relaxed);
+  } else {
+    cell.store(cell.load(std::memory_order_relaxed) + delta,
+               std::memory_order_relaxed);
+  }
+}
+
+constexpr auto bucket_of(uint64_t const value) noexcept -> size_t {
+  size_t bucket = 0;
+  for (auto v = value; v > 1 && bucket + 1 < histogram_buckets; v >>= 1) {
+    ++bucket;
+  }
+  return bucket;
+}
+} // namespace detail
+
+// definitions that change with XARROW_METRICS, kept apart per setting
+inline namespace XARROW_METRICS_HOOKS {
+inline void add([[maybe_unused]] Counter const counter,
+                [[maybe_unused]] int64_t const delta) noexcept {
+#if XARROW_METRICS
+  auto &local = detail::local();
+  detail::bump(local.counters[static_cast<size_t>(counter)], delta,
+               local.shared);
+#endif
+}
+
+inline void on_allocate([[maybe_unused]] size_t const bytes) noexcept {
+#if XARROW_METRICS
+  auto &local = detail::local();
+  auto const b = static_cast<int64_t>(bytes);
+  detail::bump(local.counters[static_cast<size_t>(Counter::BYTES_ALLOCATED)],
+               b, local.shared);
+  detail::bump(local.counters[static_cast<size_t>(Counter::BYTES_LIVE)], b,
+               local.shared);
+  detail::bump(local.counters[static_cast<size_t>(Counter::ALLOCATIONS)],
+               int64_t{1}, local.shared);
+  detail::bump(local.allocation_bytes[detail::bucket_of(bytes)], uint64_t{1},
+               local.shared);
+#endif
+}
+
+inline void on_free([[maybe_unused]] size_t const bytes) noexcept {
+  add(Counter::BYTES_LIVE, -static_cast<int64_t>(bytes));
+}
+
+/**
+ * @brief an ArrowArray handed out with an owning release callback
+ */
+inline void on_export() noexcept {
+  add(Counter::EXPORTS, 1);
+  add(Counter::EXPORTS_OUTSTANDING, 1);
+}
+inline void on_release() noexcept { add(Counter::EXPORTS_OUTSTANDING, -1); }
+
+/**
+ * @brief times a kernel call over rows rows, from construction to scope exit
+ */
+class KernelTimer {
+public:
+  explicit KernelTimer([[maybe_unused]] size_t const rows) noexcept
+#if XARROW_METRICS
+      : rows_(rows), start_(std::chrono::steady_clock::now())
+#endif
+  {
+  }
+  ~KernelTimer() noexcept {
+#if XARROW_METRICS
+    auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start_)
+                        .count();
+    auto &local = detail::local();
+    auto const rows = static_cast<int64_t>(rows_);
+    detail::bump(local.counters[static_cast<size_t>(Counter::KERNEL_CALLS)],
+                 int64_t{1}, local.shared);
+    detail::bump(local.counters[static_cast<size_t>(Counter::KERNEL_ROWS)],
+                 rows, local.shared);
+    detail::bump(local.counters[static_cast<size_t>(Counter::KERNEL_NS)],
+                 static_cast<int64_t>(ns), local.shared);
+    if (rows_ > 0) {
+      auto const ps = static_cast<uint64_t>(ns) * 1000 / rows_;
+      detail::bump(local.kernel_ps_per_row[detail::bucket_of(ps)],
+                   uint64_t{1}, local.shared);
+    }
+#endif
+  }
+  KernelTimer(KernelTimer const &) = delete;
+  auto operator=(KernelTimer const &) -> KernelTimer & = delete;
+  KernelTimer(KernelTimer &&) = delete;
+  auto operator=(KernelTimer &&) -> KernelTimer & = delete;
+
+private:
+#if XARROW_METRICS
+  size_t rows_;
+  std::chrono::steady_clock::time_point start_;
+#endif
+};
+} // namespace XARROW_METRICS_HOOKS
+} // namespace metrics
+} // namespace xarrow
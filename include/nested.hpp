@@ -0,0 +1,283 @@
+/**
+ * @file nested.hpp
+ * @brief List and fixed-size-list column builders
+ *
+ * Lists keep an offsets vector plus one contiguous child vector; fixed-size
+ * lists only the child vector, so row r starts at r * N. Both export a
+ * two-level ArrowSchema/ArrowArray tree whose child is owned by the parent's
+ * release callback.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "arrow.hpp"
+#include "common.hpp"
+#include "data_types.hpp"
+#include "xarrow.hpp"
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace xarrow {
+namespace detail {
+struct NestedSchemaHolder {
+  std::string format;
+  std::string name;
+  std::string child_format;
+  ArrowSchema child{};
+  ArrowSchema *child_ptr = nullptr;
+};
+
+// owns the storage for move exports, only points at it for ref exports
+struct NestedArrayHolder {
+  std::shared_ptr<void const> storage;
+  std::array<const void *, 2> buffers{};
+  std::array<const void *, 2> child_buffers{};
+  ArrowArray child{};
+  ArrowArray *child_ptr = nullptr;
+};
+
+/**
+ * @brief fill schema from holder, owned schemas delete holder on release
+ */
+inline void nested_schema(ArrowSchema &schema, NestedSchemaHolder &holder,
+                          bool const owned) {
+  holder.child = ArrowSchema{};
+  holder.child.format = holder.child_format.c_str();
+  holder.child.name = "item";
+  // released together with the parent
+  holder.child.release = [](struct ArrowSchema *now) {
+    now->release = nullptr;
+  };
+  holder.child_ptr = &holder.child;
+
+  schema.format = holder.format.c_str();
+  schema.name = holder.name.c_str();
+  schema.metadata = nullptr;
+  schema.flags = 0;
+  schema.n_children = 1;
+  schema.children = &holder.child_ptr;
+  schema.dictionary = nullptr;
+  if (owned) {
+    schema.release = [](struct ArrowSchema *now) {
+      delete static_cast<NestedSchemaHolder *>(now->private_data);
+      now->release = nullptr;
+    };
+    schema.private_data = &holder;
+  } else {
+    schema.release = [](struct ArrowSchema * /*unused*/) {};
+    schema.private_data = nullptr;
+  }
+}
+
+/**
+ * @brief fill array from holder, whose buffers must already be set
+ */
+inline void nested_array(ArrowArray &array, NestedArrayHolder &holder,
+                         size_t const length, int64_t const n_buffers,
+                         size_t const child_length, bool const owned) {
+  holder.child = ArrowArray{};
+  holder.child.length = static_cast<int64_t>(child_length);
+  holder.child.n_buffers = 2;
+  holder.child.buffers = holder.child_buffers.data();
+  // released together with the parent
+  holder.child.release = [](struct ArrowArray *now) { now->release = nullptr; };
+  holder.child_ptr = &holder.child;
+
+  array.length = static_cast<int64_t>(length);
+  array.null_count = 0;
+  array.offset = 0;
+  array.n_buffers = n_buffers;
+  array.n_children = 1;
+  array.buffers = holder.buffers.data();
+  array.children = &holder.child_ptr;
+  array.dictionary = nullptr;
+  if (owned) {
+    array.release = [](struct ArrowArray *now) {
+      delete static_cast<NestedArrayHolder *>(now->private_data);
+      now->release = nullptr;
+      metrics::on_release();
+    };
+    array.private_data = &holder;
+    metrics::on_export();
+  } else {
+    array.release = [](struct ArrowArray * /*unused*/) {};
+    array.private_data = nullptr;
+  }
+}
+} // namespace detail
+
+/**
+ * @brief variable length lists of T, "+l" with int32 offsets or "+L" with
+ * int64 offsets
+ */
+template <class T, class Offset = int32_t> struct XArrowList {
+  static_assert(std::is_same_v<Offset, int32_t> ||
+                    std::is_same_v<Offset, int64_t>,
+                "list offsets are int32 or int64");
+  static_assert(!is_parameterized_v<T>,
+                "list children must have a fixed format");
+  constexpr static auto format = std::is_same_v<Offset, int32_t> ? "+l" : "+L";
+
+  explicit XArrowList(std::string_view name) : name_(name) {
+    offsets_.push_back(0);
+  }
+
+  void append(T const *values, size_t const n) {
+    auto const old = values_.size();
+    if (old + n > static_cast<size_t>(std::numeric_limits<Offset>::max()))
+        [[unlikely]] {
+      throw std::length_error("XArrowList: offsets overflow");
+    }
+    values_.resize(old + n);
+    if (n > 0) {
+      std::memcpy(values_.data() + old, values, n * sizeof(T));
+    }
+    offsets_.push_back(static_cast<Offset>(old + n));
+  }
+  void append(std::initializer_list<T> values) {
+    append(values.begin(), values.size());
+  }
+
+  auto name() const noexcept -> std::string_view { return name_; }
+  [[nodiscard]] auto size() const noexcept -> size_t {
+    return offsets_.size() - 1;
+  }
+  [[nodiscard]] auto row_size(size_t const row) const noexcept -> size_t {
+    return static_cast<size_t>(offsets_[row + 1] - offsets_[row]);
+  }
+  [[nodiscard]] auto row_data(size_t const row) const noexcept -> T const * {
+    return values_.data() + offsets_[row];
+  }
+  auto offsets() const noexcept -> AlignedVector<Offset, alignment> const & {
+    return offsets_;
+  }
+  auto values() const noexcept -> AlignedVector<T, alignment> const & {
+    return values_;
+  }
+
+  void to_schema_ref(ArrowSchema &schema) const {
+    schema_ = {format, name_, type2format<T>()};
+    detail::nested_schema(schema, schema_, false);
+  }
+  void to_schema_move(ArrowSchema &schema) const {
+    detail::nested_schema(
+        schema,
+        *new detail::NestedSchemaHolder{format, name_, type2format<T>()}, true);
+  }
+  void to_array_ref(ArrowArray &array) const {
+    array_.storage = nullptr;
+    array_.buffers = {nullptr, offsets_.data()};
+    array_.child_buffers = {nullptr, values_.data()};
+    detail::nested_array(array, array_, size(), 2, values_.size(), false);
+  }
+  /**
+   * @brief construct ArrowArray and transfer ownership
+   * The list is left empty afterwards.
+   * @param array target output place
+   */
+  void to_array_move(ArrowArray &array) {
+    auto const length = size();
+    auto storage = std::make_shared<Storage>(
+        Storage{std::move(offsets_), std::move(values_)});
+    offsets_ = AlignedVector<Offset, alignment>();
+    values_ = AlignedVector<T, alignment>();
+    offsets_.push_back(0);
+
+    auto *holder = new detail::NestedArrayHolder();
+    holder->buffers = {nullptr, storage->offsets.data()};
+    holder->child_buffers = {nullptr, storage->values.data()};
+    auto const child_length = storage->values.size();
+    holder->storage = std::move(storage);
+    detail::nested_array(array, *holder, length, 2, child_length, true);
+  }
+
+private:
+  struct Storage {
+    AlignedVector<Offset, alignment> offsets;
+    AlignedVector<T, alignment> values;
+  };
+
+  std::string name_;
+  AlignedVector<Offset, alignment> offsets_;
+  AlignedVector<T, alignment> values_;
+  mutable detail::NestedSchemaHolder schema_;
+  mutable detail::NestedArrayHolder array_;
+};
+
+template <class T> using XArrowLargeList = XArrowList<T, int64_t>;
+
+/**
+ * @brief lists of exactly N values of T, "+w:N"
+ * All values sit in one contiguous 64-byte aligned buffer, row r at r * N.
+ */
+template <class T, size_t N> struct XArrowFixedSizeList {
+  static_assert(N > 0, "fixed size lists need at least one value per row");
+  static_assert(!is_parameterized_v<T>,
+                "list children must have a fixed format");
+
+  explicit XArrowFixedSizeList(std::string_view name) : name_(name) {}
+
+  void append(T const *row) {
+    auto const old = values_.size();
+    values_.resize(old + N);
+    std::memcpy(values_.data() + old, row, N * sizeof(T));
+  }
+  void append(std::array<T, N> const &row) { append(row.data()); }
+  void reserve(size_t const rows) { values_.reserve(rows * N); }
+
+  auto name() const noexcept -> std::string_view { return name_; }
+  [[nodiscard]] auto size() const noexcept -> size_t {
+    return values_.size() / N;
+  }
+  auto operator[](size_t const row) const noexcept -> T const * {
+    return values_.data() + row * N;
+  }
+  auto values() const noexcept -> AlignedVector<T, alignment> const & {
+    return values_;
+  }
+
+  [[nodiscard]] static auto type_format() -> std::string {
+    return "+w:" + std::to_string(N);
+  }
+
+  void to_schema_ref(ArrowSchema &schema) const {
+    schema_ = {type_format(), name_, type2format<T>()};
+    detail::nested_schema(schema, schema_, false);
+  }
+  void to_schema_move(ArrowSchema &schema) const {
+    detail::nested_schema(
+        schema,
+        *new detail::NestedSchemaHolder{type_format(), name_, type2format<T>()},
+        true);
+  }
+  void to_array_ref(ArrowArray &array) const {
+    array_.storage = nullptr;
+    array_.buffers = {nullptr, nullptr};
+    array_.child_buffers = {nullptr, values_.data()};
+    detail::nested_array(array, array_, size(), 1, values_.size(), false);
+  }
+  /**
+   * @brief construct ArrowArray and transfer ownership
+   * The list is left empty afterwards.
+   * @param array target output place
+   */
+  void to_array_move(ArrowArray &array) {
+    auto const length = size();
+    auto storage =
+        std::make_shared<AlignedVector<T, alignment>>(std::move(values_));
+    values_ = AlignedVector<T, alignment>();
+
+    auto *holder = new detail::NestedArrayHolder();
+    holder->child_buffers = {nullptr, storage->data()};
+    auto const child_length = storage->size();
+    holder->storage = std::move(storage);
+    detail::nested_array(array, *holder, length, 1, child_length, true);
+  }
+
+private:
+  std::string name_;
+  AlignedVector<T, alignment> values_;
+  mutable detail::NestedSchemaHolder schema_;
+  mutable detail::NestedArrayHolder array_;
+};
+} // namespace xarrow
@@ -0,0 +1,89 @@
+/**
+ * @file parquet.hpp
+ * @brief Streaming Parquet writer for non-null columns
+ *
+ * Rows are gathered into row groups of row_group_rows rows across write()
+ * calls. Each batch is encoded on arrival into the open group's column
+ * chunks, in parallel across columns, without keeping a copy of the rows.
+ * A full group is appended to the file descriptor in column order, so
+ * memory use stays around one encoded row group. The footer is written by
+ * close(), after the last, possibly shorter, group.
+ *
+ * Columns are REQUIRED (no nulls). Each chunk is dictionary encoded, with
+ * RLE/bit-packed hybrid indices, when its distinct values fit the options,
+ * and PLAIN encoded otherwise. Pages and chunks carry min/max statistics.
+ * Supported types are bool, the integer and floating point types, DATE32,
+ * TIMESTAMP in milli, micro or nanoseconds, and DECIMAL128.
+ */
+#pragma once
+#include "column_handle.hpp"
+#include "common.hpp"
+#include "xarrow.hpp"
+#include <string>
+#include <string_view>
+
+namespace xarrow {
+enum class ParquetCompression : uint8_t {
+  NONE,
+  // LZ4 block format without framing, built in
+  LZ4_RAW,
+  // needs XARROW_WITH_ZSTD and libzstd
+  ZSTD,
+};
+
+struct ParquetOptions {
+  size_t row_group_rows = size_t{1} << 20;
+  // target size of the values in one data page, before compression
+  size_t page_bytes = size_t{1} << 20;
+  ParquetCompression compression = ParquetCompression::NONE;
+  bool dictionary = true;
+  // chunks with more distinct values fall back to PLAIN
+  size_t dictionary_max_entries = size_t{1} << 16;
+  // column chunk encoders, 0 means one per hardware thread
+  size_t threads = 0;
+};
+
+class ParquetWriter {
+public:
+  /**
+   * @brief start a file on fd, which stays owned by the caller
+   * Writes sequentially, so pipes and sockets work too.
+   */
+  explicit ParquetWriter(int fd, ParquetOptions const &options = {});
+  /**
+   * @brief closes the file if close() was not called, dropping errors
+   */
+  ~ParquetWriter() noexcept;
+
+  ParquetWriter(ParquetWriter const &) = delete;
+  auto operator=(ParquetWriter const &) -> ParquetWriter & = delete;
+  ParquetWriter(ParquetWriter &&) = delete;
+  auto operator=(ParquetWriter &&) -> ParquetWriter & = delete;
+
+  /**
+   * @brief append a batch of equally long columns
+   * The first batch fixes the schema; later ones must match its names and
+   * formats. Throws std::invalid_argument on mismatches or unsupported types.
+   */
+  void write(std::vector<ColumnHandle> const &columns);
+  void write(std::vector<XArrowVariant> const &columns) {
+    write(column_handles(columns));
+  }
+  template <class... Ts> void write(XArrowNonNull<Ts> const &...columns) {
+    write(std::vector<ColumnHandle>{column_handle(columns)...});
+  }
+
+  /**
+   * @brief flush the buffered rows and write the footer, no batch may follow
+   */
+  void close();
+
+  // rows accepted so far, including ones still buffered
+  [[nodiscard]] auto rows_written() const noexcept -> int64_t;
+  [[nodiscard]] auto bytes_written() const noexcept -> uint64_t;
+
+private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+} // namespace xarrow
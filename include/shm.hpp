@@ -0,0 +1,163 @@
+/**
+ * @file shm.hpp
+ * @brief Zero-copy Arrow exchange between processes on the same host
+ *
+ * Producer allocates column storage inside a memfd backed ShmArena, then
+ * ShmBatchWriter sends the arena fd plus buffer offsets over a unix socket.
+ * shm_receive maps the same pages on the peer side and rebuilds a struct
+ * ("+s") ArrowSchema/ArrowArray tree pointing into them.
+ *
+ * Arena memory is bump allocated and only reclaimed as a whole by
+ * ShmArena::reset, once every receiver has released its arrays. Reserve
+ * column capacity up front, as growth leaves the old buffer behind.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "arrow.hpp"
+#include "common.hpp"
+#include "data_types.hpp"
+#include "xarrow.hpp"
+#include <atomic>
+#include <string>
+#include <string_view>
+
+namespace xarrow {
+namespace detail {
+struct ShmHeader;
+} // namespace detail
+
+class ShmArena {
+public:
+  /**
+   * @brief create a fresh anonymous shared memory arena
+   * @param capacity usable bytes, excluding the arena header
+   */
+  explicit ShmArena(size_t capacity);
+  /**
+   * @brief map an arena received from a peer, taking ownership of fd
+   */
+  static auto attach(int fd) -> std::shared_ptr<ShmArena>;
+  ~ShmArena() noexcept;
+
+  ShmArena(const ShmArena &) = delete;
+  auto operator=(const ShmArena &) -> ShmArena & = delete;
+  ShmArena(ShmArena &&) = delete;
+  auto operator=(ShmArena &&) -> ShmArena & = delete;
+
+  /**
+   * @brief thread-safe bump allocation, nullptr when the arena is full
+   */
+  [[nodiscard]] auto allocate(size_t alignment, size_t size) noexcept
+      -> void *;
+
+  [[nodiscard]] auto fd() const noexcept -> int { return fd_; }
+  [[nodiscard]] auto size() const noexcept -> size_t { return size_; }
+  [[nodiscard]] auto used() const noexcept -> size_t;
+  [[nodiscard]] auto contains(const void *ptr) const noexcept -> bool;
+  [[nodiscard]] auto offset_of(const void *ptr) const -> uint64_t;
+  /**
+   * @brief pointer to bytes at offset, throws unless all of them are mapped
+   */
+  [[nodiscard]] auto at(uint64_t offset, uint64_t bytes = 1) const -> void *;
+
+  /**
+   * @brief arrays handed to receivers and not yet released, in any process
+   */
+  [[nodiscard]] auto outstanding() const noexcept -> int64_t;
+  void retain() noexcept;
+  void release() noexcept;
+
+  /**
+   * @brief drop every allocation at once
+   * Throws std::logic_error while receivers still hold arrays.
+   */
+  void reset();
+
+private:
+  ShmArena(int fd, size_t size);
+  [[nodiscard]] auto header() const noexcept -> detail::ShmHeader *;
+
+  int fd_;
+  size_t size_;
+  owner<std::byte *> base_;
+};
+
+/**
+ * @brief AlignedBuffer backend carving buffers out of a ShmArena
+ * deallocate is a no-op, see ShmArena::reset.
+ */
+struct ShmAllocator {
+  ShmArena *arena = nullptr;
+
+  [[nodiscard]] auto allocate(size_t const alignment,
+                              size_t const size) const noexcept -> void * {
+    return arena == nullptr ? nullptr : arena->allocate(alignment, size);
+  }
+  static void deallocate(void * /*unused*/) noexcept {}
+};
+
+template <class T>
+using ShmVector = AlignedVector<T, alignment, ShmAllocator>;
+
+/**
+ * @brief collects flat columns living in an arena and sends their descriptor
+ */
+class ShmBatchWriter {
+public:
+  explicit ShmBatchWriter(ShmArena &arena) noexcept : arena_(arena) {}
+
+  /**
+   * @brief add a flat column, every non-null buffer must lie in the arena
+   */
+  void add(ArrowSchema const &schema, ArrowArray const &array);
+
+  template <class T> void add(std::string_view name, ShmVector<T> const &data) {
+    static_assert(!is_parameterized_v<T>,
+                  "use add(schema, array) for parameterized types");
+    ArrowSchema schema{};
+    schema.format = type2format<T>();
+    auto const t_name = std::string(name);
+    schema.name = t_name.c_str();
+    ArrowArray array{};
+    std::array<const void *, 2> buffers{nullptr, data.data()};
+    array.length = static_cast<int64_t>(data.size());
+    array.n_buffers = 2;
+    array.buffers = buffers.data();
+    add(schema, array);
+  }
+
+  [[nodiscard]] auto num_columns() const noexcept -> size_t {
+    return columns_.size();
+  }
+
+  /**
+   * @brief send fd and descriptor over a connected SOCK_STREAM unix socket
+   * Counts as one outstanding reference until the receiver releases.
+   */
+  void send(int socket) const;
+
+private:
+  struct Column {
+    std::string format;
+    std::string name;
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    std::vector<uint64_t> buffers;
+  };
+
+  ShmArena &arena_;
+  std::vector<Column> columns_;
+};
+
+/**
+ * @brief receive a batch sent by ShmBatchWriter::send
+ * Fills a struct ("+s") schema/array pair whose children are the columns.
+ * Both trees carry their own release callback, and so does every child,
+ * which may be moved out; the mapping stays alive until the array and all
+ * moved-out children are released. Columns must be equally long, and
+ * primitive, decimal or (large) string/binary, and every buffer must fit
+ * inside the mapping; anything else throws.
+ */
+void shm_receive(int socket, ArrowSchema &schema, ArrowArray &array);
+} // namespace xarrow
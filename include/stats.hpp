@@ -0,0 +1,267 @@
+/**
+ * @file stats.hpp
+ * @brief Column statistics and per-block zone maps
+ *
+ * StatsColumn keeps min/max per fixed-size block of rows as values are
+ * appended, plus a HyperLogLog distinct estimate for the whole column. Range
+ * filters ask candidate_blocks for the blocks that may match and skip the
+ * rest; exported schemas carry the column statistics in their metadata.
+ */
+#pragma once
+#include "aligned_vector.hpp"
+#include "arrow.hpp"
+#include "common.hpp"
+#include "data_types.hpp"
+#include "xarrow.hpp"
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+namespace xarrow {
+/**
+ * @brief encode key/value pairs in the ArrowSchema.metadata layout
+ */
+auto encode_metadata(
+    std::vector<std::pair<std::string, std::string>> const &pairs)
+    -> std::string;
+/**
+ * @brief decode ArrowSchema.metadata, nullptr yields no pairs
+ * Throws std::runtime_error on a negative count or length.
+ */
+auto decode_metadata(const char *metadata)
+    -> std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief distinct count estimate with 2^12 registers, about 1.6% error
+ */
+class HyperLogLog {
+public:
+  constexpr static int precision = 12;
+
+  void add(uint64_t const hash) noexcept {
+    auto const index = hash >> (64 - precision);
+    auto const rest = hash << precision;
+    auto const rank = static_cast<uint8_t>(
+        rest == 0 ? 64 - precision + 1 : __builtin_clzll(rest) + 1);
+    registers_[index] = std::max(registers_[index], rank);
+  }
+  void merge(HyperLogLog const &other) noexcept;
+  [[nodiscard]] auto estimate() const noexcept -> double;
+  void clear() noexcept { registers_.fill(0); }
+
+private:
+  std::array<uint8_t, size_t{1} << precision> registers_{};
+};
+
+namespace detail {
+// splitmix64 finalizer
+constexpr auto mix64(uint64_t x) noexcept -> uint64_t {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+template <class T> auto hash_value(T value) noexcept -> uint64_t {
+  if constexpr (std::is_floating_point_v<T>) {
+    // -0.0 and 0.0 are the same value
+    if (value == 0) {
+      value = 0;
+    }
+  }
+  std::array<uint64_t, (sizeof(T) + 7) / 8> words{};
+  std::memcpy(words.data(), &value, sizeof(T));
+  uint64_t hash = sizeof(T);
+  for (auto const word : words) {
+    hash = mix64(hash ^ word);
+  }
+  return hash;
+}
+
+auto decimal128_string(Decimal128 value) -> std::string;
+
+/**
+ * @brief value as written to metadata, decimals unscaled
+ */
+template <class T> auto stats_string(T const &value) -> std::string {
+  if constexpr (std::is_same_v<T, bool>) {
+    return value ? "true" : "false";
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    std::array<char, 64> buf{};
+    auto const res = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    return {buf.data(), res.ptr};
+  } else if constexpr (std::is_same_v<T, Decimal128>) {
+    return decimal128_string(value);
+  } else {
+    return stats_string(value.value);
+  }
+}
+} // namespace detail
+
+template <class T> struct BlockStats {
+  T min;
+  T max;
+  size_t count;
+};
+
+template <class T> struct ColumnStats {
+  // min and max are value-initialized for an empty column
+  T min;
+  T max;
+  size_t count;
+  size_t null_count;
+  double distinct;
+};
+
+/**
+ * @brief non-null column maintaining statistics while it is appended to
+ * Values only enter through push_back/append, so the statistics never go
+ * stale. Blocks are consecutive runs of block_rows() rows; the last one may
+ * be partial. Null count is always 0, kept for symmetry with the metadata.
+ */
+template <class T> class StatsColumn {
+  static_assert(!std::is_same_v<T, Decimal256>,
+                "Decimal256 has no ordering for zone maps");
+
+public:
+  constexpr static size_t default_block_rows = 8192;
+
+  explicit StatsColumn(std::string_view name,
+                       size_t const block_rows = default_block_rows)
+      : name_(name), column_(name), block_rows_(checked(block_rows)) {}
+  /**
+   * @brief column with a full format, e.g. "tsn:UTC"
+   */
+  StatsColumn(std::string_view name, std::string format,
+              size_t const block_rows = default_block_rows)
+      : name_(name), column_(name, std::move(format)),
+        block_rows_(checked(block_rows)) {}
+
+  void push_back(T const value) {
+    column_.push_back(value);
+    observe(value);
+  }
+  void append(T const *values, size_t const n) {
+    column_.append(values, n);
+    for (size_t i = 0; i < n; ++i) {
+      observe(values[i]);
+    }
+  }
+
+  auto name() const noexcept -> std::string_view { return name_; }
+  [[nodiscard]] auto type_format() const noexcept -> std::string const & {
+    return column_.type_format();
+  }
+  [[nodiscard]] auto size() const noexcept -> size_t {
+    return column_.data().size();
+  }
+  auto column() const noexcept -> XArrowNonNull<T> const & { return column_; }
+
+  [[nodiscard]] auto block_rows() const noexcept -> size_t {
+    return block_rows_;
+  }
+  [[nodiscard]] auto num_blocks() const noexcept -> size_t {
+    return zones_.size();
+  }
+  auto zones() const noexcept -> std::vector<BlockStats<T>> const & {
+    return zones_;
+  }
+  /**
+   * @brief zero-copy view of the rows of block i
+   */
+  [[nodiscard]] auto block(size_t const i) const -> XArrowSlice<T> {
+    return column_.slice(i * block_rows_, zones_.at(i).count);
+  }
+
+  /**
+   * @brief blocks whose [min, max] intersects [low, high], in row order
+   */
+  [[nodiscard]] auto candidate_blocks(T const &low, T const &high) const
+      -> std::vector<size_t> {
+    std::vector<size_t> blocks;
+    for (size_t i = 0; i < zones_.size(); ++i) {
+      if (!(zones_[i].max < low) && !(high < zones_[i].min)) {
+        blocks.push_back(i);
+      }
+    }
+    return blocks;
+  }
+
+  [[nodiscard]] auto stats() const noexcept -> ColumnStats<T> {
+    ColumnStats<T> stats{T{}, T{}, size(), 0, distinct_.estimate()};
+    if (!zones_.empty()) {
+      stats.min = zones_.front().min;
+      stats.max = zones_.front().max;
+    }
+    for (auto const &zone : zones_) {
+      stats.min = zone.min < stats.min ? zone.min : stats.min;
+      stats.max = stats.max < zone.max ? zone.max : stats.max;
+    }
+    return stats;
+  }
+
+  /**
+   * @brief statistics encoded as ArrowSchema.metadata under "xarrow.stats.*"
+   * min and max are left out while the column is empty.
+   */
+  [[nodiscard]] auto metadata() const -> std::string {
+    auto const s = stats();
+    std::vector<std::pair<std::string, std::string>> pairs{
+        {"xarrow.stats.row_count", std::to_string(s.count)},
+        {"xarrow.stats.null_count", std::to_string(s.null_count)},
+        {"xarrow.stats.distinct_count",
+         std::to_string(std::llround(s.distinct))},
+    };
+    if (s.count > 0) {
+      pairs.emplace_back("xarrow.stats.min", detail::stats_string(s.min));
+      pairs.emplace_back("xarrow.stats.max", detail::stats_string(s.max));
+    }
+    return encode_metadata(pairs);
+  }
+
+  void to_schema_ref(ArrowSchema &schema) const {
+    metadata_ = metadata();
+    detail::schema_ref(schema, column_.type_format(), name_, metadata_);
+  }
+  void to_schema_move(ArrowSchema &schema) const {
+    detail::schema_move(schema, column_.type_format(), name_, metadata());
+  }
+  void to_array_ref(ArrowArray &array) const { column_.to_array_ref(array); }
+  /**
+   * @brief construct ArrowArray and transfer ownership
+   * The column and its statistics are left empty afterwards.
+   * @param array target output place
+   */
+  void to_array_move(ArrowArray &array) {
+    column_.to_array_move(array);
+    zones_.clear();
+    distinct_.clear();
+  }
+
+private:
+  static auto checked(size_t const block_rows) -> size_t {
+    if (block_rows == 0) {
+      throw std::invalid_argument("StatsColumn: block_rows must be positive");
+    }
+    return block_rows;
+  }
+
+  void observe(T const &value) {
+    if (zones_.empty() || zones_.back().count == block_rows_) {
+      zones_.push_back({value, value, 0});
+    }
+    auto &zone = zones_.back();
+    zone.min = value < zone.min ? value : zone.min;
+    zone.max = zone.max < value ? value : zone.max;
+    ++zone.count;
+    distinct_.add(detail::hash_value(value));
+  }
+
+  std::string name_;
+  XArrowNonNull<T> column_;
+  size_t block_rows_;
+  std::vector<BlockStats<T>> zones_;
+  HyperLogLog distinct_;
+  mutable std::string metadata_;
+};
+} // namespace xarrow
@@ -1,97 +1,371 @@
+#pragma once
 #include "aligned_vector.hpp"
 #include "arrow.hpp"
 #include "common.hpp"
 #include "data_types.hpp"
+#include <atomic>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <string_view>
 
 namespace xarrow {
 constexpr static size_t alignment = 64;
-namespace detail {} // namespace detail
+namespace detail {
+/// owns everything an exported ArrowArray points to
+template <class T> struct ExportHolder {
+  std::shared_ptr<AlignedVector<T, alignment> const> data;
+  std::array<const void *, 2> buffers;
+};
+
+/**
+ * @brief export [offset, offset + length) of data, sharing its ownership
+ * The storage stays alive until the consumer calls release.
+ */
+template <class T>
+void export_array(ArrowArray &array,
+                  std::shared_ptr<AlignedVector<T, alignment> const> data,
+                  size_t const offset, size_t const length) {
+  auto *holder = new ExportHolder<T>{std::move(data), {nullptr, nullptr}};
+  holder->buffers[1] = holder->data->data();
+  array.length = static_cast<int64_t>(length);
+  array.null_count = 0;
+  array.offset = static_cast<int64_t>(offset);
+  array.n_buffers = 2;
+  array.n_children = 0;
+  array.buffers = holder->buffers.data();
+  array.children = nullptr;
+  array.dictionary = nullptr;
+  array.release = [](struct ArrowArray *now) {
+    delete static_cast<ExportHolder<T> *>(now->private_data);
+    now->release = nullptr;
+    metrics::on_release();
+  };
+  array.private_data = holder;
+  metrics::on_export();
+}
+
+inline void schema_ref(ArrowSchema &schema, std::string const &format,
+                       std::string const &name,
+                       std::string const &metadata = {}) {
+  schema.format = format.c_str();
+  schema.name = name.c_str();
+  schema.metadata = metadata.empty() ? nullptr : metadata.data();
+  schema.flags = 0;
+  schema.n_children = 0;
+  schema.children = nullptr;
+  schema.dictionary = nullptr;
+  schema.release = [](struct ArrowSchema * /*unused*/) {};
+  schema.private_data = nullptr;
+}
+
+struct SchemaHolder {
+  std::string format;
+  std::string name;
+  // encoded ArrowSchema.metadata, empty for none
+  std::string metadata{};
+};
+
+inline void schema_move(ArrowSchema &schema, std::string const &format,
+                        std::string const &name,
+                        std::string const &metadata = {}) {
+  auto *holder = new SchemaHolder{format, name, metadata};
+  schema.format = holder->format.c_str();
+  schema.name = holder->name.c_str();
+  schema.metadata = metadata.empty() ? nullptr : holder->metadata.data();
+  schema.flags = 0;
+  schema.n_children = 0;
+  schema.children = nullptr;
+  schema.dictionary = nullptr;
+  schema.release = [](struct ArrowSchema *now) {
+    delete static_cast<SchemaHolder *>(now->private_data);
+    now->release = nullptr;
+  };
+  schema.private_data = holder;
+}
+
+/**
+ * @brief full format of a T column, checked against T
+ */
+template <class T> auto checked_format(std::string format) -> std::string {
+  if (format2type_enum(format.c_str()) != type2type_enum<T>()) {
+    throw std::invalid_argument("format does not match the column type");
+  }
+  return format;
+}
+} // namespace detail
+
+/**
+ * @brief zero-copy window over a column
+ * Shares ownership of the parent storage, so it stays valid after the parent
+ * column is destroyed. The parent only appends past the rows a slice sees,
+ * and moves to a new buffer when it outgrows the shared one or is detached,
+ * so the slice and its exported ArrowArrays keep their rows.
+ */
+template <class T> struct XArrowSlice {
+  XArrowSlice(std::string_view name, std::string_view format,
+              std::shared_ptr<AlignedVector<T, alignment> const> data,
+              size_t const offset, size_t const length)
+      : name_(name), format_(format), data_(std::move(data)), offset_(offset),
+        length_(length) {
+    if (data_ == nullptr || offset > data_->size() ||
+        length > data_->size() - offset) [[unlikely]] {
+      throw std::out_of_range("XArrowSlice: window out of range");
+    }
+  }
+
+  auto name() const noexcept -> std::string_view { return name_; }
+  [[nodiscard]] auto type_format() const noexcept -> std::string const & {
+    return format_;
+  }
+  [[nodiscard]] auto offset() const noexcept -> size_t { return offset_; }
+  [[nodiscard]] auto size() const noexcept -> size_t { return length_; }
+  [[nodiscard]] auto empty() const noexcept -> bool { return length_ == 0; }
+
+  [[nodiscard]] auto data() const noexcept -> T const * {
+    return data_->data() + offset_;
+  }
+  [[nodiscard]] auto begin() const noexcept -> T const * { return data(); }
+  [[nodiscard]] auto end() const noexcept -> T const * {
+    return data() + length_;
+  }
+  auto operator[](size_t const pos) const noexcept -> T const & {
+    return data()[pos];
+  }
+  auto at(size_t const pos) const -> T const & {
+    if (pos >= length_) [[unlikely]] {
+      throw std::out_of_range("XArrowSlice::at: pos out of range");
+    }
+    return data()[pos];
+  }
+
+  /**
+   * @brief sub-window relative to this slice, O(1)
+   */
+  [[nodiscard]] auto slice(size_t const offset, size_t const length) const
+      -> XArrowSlice {
+    if (offset > length_ || length > length_ - offset) [[unlikely]] {
+      throw std::out_of_range("XArrowSlice::slice: window out of range");
+    }
+    return XArrowSlice(name_, format_, data_, offset_ + offset, length);
+  }
+
+  void to_schema_ref(ArrowSchema &schema) const {
+    detail::schema_ref(schema, format_, name_);
+  }
+  void to_schema_move(ArrowSchema &schema) const {
+    detail::schema_move(schema, format_, name_);
+  }
+  void to_array_ref(ArrowArray &array) const {
+    array.length = static_cast<int64_t>(length_);
+    array.null_count = 0;
+    array.offset = static_cast<int64_t>(offset_);
+    array.n_buffers = 2;
+    array.n_children = 0;
+    buffers_[1] = data_->data();
+    array.buffers = buffers_.data();
+    array.children = nullptr;
+    array.dictionary = nullptr;
+    array.release = [](struct ArrowArray * /*unused*/) {};
+    array.private_data = nullptr;
+  }
+  /**
+   * @brief construct ArrowArray holding its own reference to the storage
+   * The slice itself stays usable afterwards.
+   * @param array target output place
+   */
+  void to_array_move(ArrowArray &array) const {
+    detail::export_array<T>(array, data_, offset_, length_);
+  }
+
+private:
+  std::string name_;
+  std::string format_;
+  std::shared_ptr<AlignedVector<T, alignment> const> data_;
+  size_t offset_;
+  size_t length_;
+  mutable std::array<const void *, 2> buffers_{};
+};
 
 template <class T> struct XArrowNonNull {
+  // only the prefix for parameterized types, see type_format()
   constexpr static auto format = type2format<T>();
 
   XArrowNonNull(std::string_view name)
-      : name_(name), data_(), buffers_({nullptr, data_.data()}) {}
+      : name_(name), format_(format),
+        data_(std::make_shared<AlignedVector<T, alignment>>()) {
+    static_assert(!is_parameterized_v<T>,
+                  "parameterized types need an explicit format");
+  }
 
   XArrowNonNull(std::string_view name, AlignedVector<T, alignment> &&data)
-      : name_(name), data_(std::move(data)), buffers_({nullptr, data_.data()}) {
+      : name_(name), format_(format),
+        data_(std::make_shared<AlignedVector<T, alignment>>(std::move(data))) {
+    static_assert(!is_parameterized_v<T>,
+                  "parameterized types need an explicit format");
+  }
+
+  /**
+   * @brief column with a full format, e.g. "tsn:UTC" or "d:12,2"
+   * Throws std::invalid_argument when format does not describe T.
+   */
+  XArrowNonNull(std::string_view name, std::string format,
+                AlignedVector<T, alignment> &&data = {})
+      : name_(name), format_(detail::checked_format<T>(std::move(format))),
+        data_(std::make_shared<AlignedVector<T, alignment>>(std::move(data))) {
   }
 
-  auto name() noexcept -> std::string_view { return name_; }
-  auto data() noexcept -> AlignedVector<T, alignment> & { return data_; }
+  XArrowNonNull(XArrowNonNull const &other)
+      : name_(other.name_), format_(other.format_),
+        data_(std::make_shared<AlignedVector<T, alignment>>(*other.data_)) {}
+  auto operator=(XArrowNonNull const &other) -> XArrowNonNull & {
+    if (this != &other) {
+      XArrowNonNull tmp(other);
+      swap(tmp);
+    }
+    return *this;
+  }
+  XArrowNonNull(XArrowNonNull &&other) noexcept
+      : name_(std::move(other.name_)), format_(std::move(other.format_)),
+        data_(std::move(other.data_)),
+        shared_(other.shared_.load(std::memory_order_relaxed)) {}
+  auto operator=(XArrowNonNull &&other) noexcept -> XArrowNonNull & {
+    if (this != &other) {
+      XArrowNonNull tmp(std::move(other));
+      swap(tmp);
+    }
+    return *this;
+  }
+  ~XArrowNonNull() = default;
+
+  auto name() const noexcept -> std::string_view { return name_; }
+  [[nodiscard]] auto type_format() const noexcept -> std::string const & {
+    return format_;
+  }
+  /**
+   * @brief read-only storage, grow with push_back/append, write via detach
+   */
   auto data() const noexcept -> const AlignedVector<T, alignment> & {
-    return data_;
+    return *data_;
   }
+
+  /**
+   * Appends never touch rows already in the column, which slices and exports
+   * may be reading. Outgrowing a shared buffer moves the column to a larger
+   * one and leaves the old buffer to them, so appends stay amortized O(1).
+   */
+  void reserve(size_t const capacity) {
+    if (capacity <= data_->capacity()) {
+      return;
+    }
+    if (!shared_.load(std::memory_order_relaxed)) {
+      data_->reserve(capacity);
+      return;
+    }
+    auto grown = std::make_shared<AlignedVector<T, alignment>>();
+    grown->reserve(capacity);
+    grown->append(data_->data(), data_->size());
+    data_ = std::move(grown);
+    shared_.store(false, std::memory_order_relaxed);
+  }
+  void push_back(T const &value) {
+    T const copy = value; // value may live in the buffer being outgrown
+    grow(1);
+    data_->push_back(copy);
+  }
+  void append(T const *values, size_t const count) {
+    grow(count);
+    data_->append(values, count);
+  }
+
+  /**
+   * @brief storage for arbitrary writes
+   * Copies the rows first if a slice or export was taken since the last
+   * detach, so those keep their values. The reference is only exclusive
+   * until the next slice or export.
+   */
+  auto detach() -> AlignedVector<T, alignment> & {
+    if (shared_.exchange(false, std::memory_order_relaxed)) {
+      data_ = std::make_shared<AlignedVector<T, alignment>>(*data_);
+    }
+    return *data_;
+  }
+
+  /**
+   * @brief zero-copy view of [offset, offset + length)
+   * The slice shares ownership of the storage with this column.
+   */
+  [[nodiscard]] auto slice(size_t const offset, size_t const length) const
+      -> XArrowSlice<T> {
+    auto result = XArrowSlice<T>(name_, format_, data_, 0, data_->size())
+                      .slice(offset, length);
+    shared_.store(true, std::memory_order_relaxed);
+    return result;
+  }
+
   void to_schema_ref(ArrowSchema &schema) const {
-    schema.format = format;
-    schema.name = name_.c_str();
-    schema.metadata = nullptr;
-    schema.flags = 0;
-    schema.n_children = 0;
-    schema.children = nullptr;
-    schema.dictionary = nullptr;
-    schema.release = []() {};
-    schema.private_data = nullptr;
+    detail::schema_ref(schema, format_, name_);
   }
   void to_schema_move(ArrowSchema &schema) const {
-    schema.format = format;
-    auto *t_name = new char[name_.size() + 1];
-    std::memcpy(t_name, name_.data(), name_.size() + 1);
-    schema.name = t_name;
-    schema.metadata = nullptr;
-    schema.flags = 0;
-    schema.n_children = 0;
-    schema.children = nullptr;
-    schema.dictionary = nullptr;
-    schema.release = [](struct ArrowSchema *now) { delete now->name; };
-    schema.private_data = nullptr;
+    detail::schema_move(schema, format_, name_);
   }
   void to_array_ref(ArrowArray &array) const {
-    array.length = data_.size();
+    array.length = static_cast<int64_t>(data_->size());
     array.null_count = 0;
     array.offset = 0;
     array.n_buffers = 2;
     array.n_children = 0;
     // direclty points to buffers_, as this is reference
-    array.buffers = const_cast<const void **>(buffers_.data());
+    // refreshed here since appends may have reallocated the storage
+    buffers_[1] = data_->data();
+    array.buffers = buffers_.data();
     array.children = nullptr;
     array.dictionary = nullptr;
-    array.release = [](struct ArrowArray *_) {};
+    array.release = [](struct ArrowArray * /*unused*/) {};
     array.private_data = nullptr;
   }
 
   /**
    * @brief construct ArrowArray and transfer ownership
-   * Never use XArrow object afterwards, as it has been moved away
+   * The column is left empty. Outstanding slices keep sharing the exported
+   * storage.
    * @param array target output place
    */
   void to_array_move(ArrowArray &array) {
-    array.length = data_.size();
-    array.null_count = 0;
-    array.offset = 0;
-    array.n_buffers = 2;
-    array.n_children = 0;
-    auto *b = new std::array<void *, 2>();
-    b->at(0) = nullptr;
-    b->at(1) = data_.data();
-    data_._leak(); /// NOTICE: ownership transferred to ArrowArray
-    array.buffers = const_cast<const void **>(b->data());
-    array.children = nullptr;
-    array.dictionary = nullptr;
-    array.release = [](struct ArrowArray *now) {
-      std::free(const_cast<void *>(now->buffers[1]));        // NOLINT
-      auto *n = reinterpret_cast<decltype(b)>(now->buffers); // NOLINT
-      delete n;
-    };
-    array.private_data = nullptr;
+    auto empty = std::make_shared<AlignedVector<T, alignment>>();
+    /// NOTICE: ownership transferred to ArrowArray
+    detail::export_array<T>(array, data_, 0, data_->size());
+    data_ = std::move(empty);
+    shared_.store(false, std::memory_order_relaxed);
+  }
+
+  void swap(XArrowNonNull &other) noexcept {
+    std::swap(name_, other.name_);
+    std::swap(format_, other.format_);
+    std::swap(data_, other.data_);
+    auto const mine = shared_.load(std::memory_order_relaxed);
+    shared_.store(other.shared_.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+    other.shared_.store(mine, std::memory_order_relaxed);
   }
 
 private:
+  // room for count more rows without reallocating a shared buffer
+  void grow(size_t const count) {
+    auto const required = data_->size() + count;
+    if (required > data_->capacity()) {
+      reserve(std::max({required, data_->capacity() + data_->capacity() / 2,
+                        size_t{4}}));
+    }
+  }
+
   std::string name_;
-  AlignedVector<T, alignment> data_;
-  std::array<void *, 2> buffers_;
+  std::string format_;
+  std::shared_ptr<AlignedVector<T, alignment>> data_;
+  // a slice or export may still read data_, set from const members
+  mutable std::atomic<bool> shared_{false};
+  mutable std::array<const void *, 2> buffers_{};
 };
 #define OPT(type, enum_class, format_str) XArrowNonNull<type>, // NOLINT
 #define END(type, enum_class, format_str) XArrowNonNull<type>  // NOLINT
@@ -148,6 +422,87 @@ struct XArrowRawSchema : ReleaseManager<ArrowSchema> {
 };
 using XArrowRawArray = ReleaseManager<ArrowArray>;
 
+namespace detail {
+/// keeps the root import alive for one pinned copy of an array
+struct RawPinHolder {
+  std::shared_ptr<XArrowRawArray> root;
+  std::vector<ArrowArray> children;
+  std::vector<ArrowArray *> child_ptrs;
+  std::unique_ptr<ArrowArray> dictionary;
+  // the top-level copy, counted by metrics
+  bool exported = false;
+};
+
+/**
+ * @brief shallow copy of src with its own children and dictionary structs
+ * Each copy, nested ones included, holds a reference to root, so a consumer
+ * may move children out and release them independently of the copy.
+ */
+inline void pin_array(ArrowArray &dst, ArrowArray const &src,
+                      std::shared_ptr<XArrowRawArray> const &root) {
+  auto holder = std::make_unique<RawPinHolder>();
+  holder->root = root;
+  auto const n_children = static_cast<size_t>(src.n_children);
+  holder->children.resize(n_children);
+  holder->child_ptrs.resize(n_children);
+  for (size_t i = 0; i < n_children; ++i) {
+    pin_array(holder->children[i], *src.children[i], root);
+    holder->child_ptrs[i] = &holder->children[i];
+  }
+  if (src.dictionary != nullptr) {
+    holder->dictionary = std::make_unique<ArrowArray>();
+    pin_array(*holder->dictionary, *src.dictionary, root);
+  }
+  dst = src;
+  dst.children = n_children == 0 ? nullptr : holder->child_ptrs.data();
+  dst.dictionary = holder->dictionary.get();
+  dst.release = [](struct ArrowArray *now) {
+    auto *pinned = static_cast<RawPinHolder *>(now->private_data);
+    // children moved out by the consumer are already released
+    for (auto &child : pinned->children) {
+      if (child.release != nullptr) {
+        child.release(&child);
+      }
+    }
+    if (pinned->dictionary && pinned->dictionary->release != nullptr) {
+      pinned->dictionary->release(pinned->dictionary.get());
+    }
+    if (pinned->exported) {
+      metrics::on_release();
+    }
+    delete pinned;
+    now->release = nullptr;
+  };
+  dst.private_data = holder.release();
+}
+} // namespace detail
+
+/**
+ * @brief zero-copy window over an imported array
+ * Buffers are shared with the parent, which is kept alive until the returned
+ * array and every child moved out of it are released. Children and
+ * dictionary get their own structs. Offsets are relative to the parent's own
+ * window.
+ */
+inline auto slice(std::shared_ptr<XArrowRawArray> parent, int64_t const offset,
+                  int64_t const length) -> XArrowRawArray {
+  auto const &src = parent->schema();
+  if (offset < 0 || length < 0 || offset > src.length ||
+      length > src.length - offset) [[unlikely]] {
+    throw std::out_of_range("slice: window out of range");
+  }
+  XArrowRawArray result;
+  auto &dst = *result.import();
+  detail::pin_array(dst, src, parent);
+  dst.length = length;
+  // nulls may all lie outside the window, so the count becomes unknown
+  dst.null_count = src.null_count == 0 ? 0 : -1;
+  dst.offset = src.offset + offset;
+  static_cast<detail::RawPinHolder *>(dst.private_data)->exported = true;
+  metrics::on_export();
+  return result;
+}
+
 struct XArrowSchema {
   XArrowSchema(XArrowRawSchema &&schema)
       : type_(format2type_enum(schema.schema().format)),
@@ -162,4 +517,148 @@ private:
   std::unique_ptr<XArrowRawSchema> schema_;
 };
 struct XArrowArray {};
+
+/**
+ * @brief many chunks presented as one logical column
+ * Chunks are held as slices, so slicing the whole column is zero-copy too.
+ * Random access binary-searches the chunk start positions.
+ */
+template <class T> struct ChunkedColumn {
+  explicit ChunkedColumn(std::string_view name)
+      : name_(name), format_(type2format<T>()), starts_{0} {
+    static_assert(!is_parameterized_v<T>,
+                  "parameterized types need an explicit format");
+  }
+  ChunkedColumn(std::string_view name, std::string format)
+      : name_(name), format_(detail::checked_format<T>(std::move(format))),
+        starts_{0} {}
+
+  void append(AlignedVector<T, alignment> &&chunk) {
+    auto const size = chunk.size();
+    append(XArrowSlice<T>(
+        name_, format_,
+        std::make_shared<AlignedVector<T, alignment>>(std::move(chunk)), 0,
+        size));
+  }
+  void append(XArrowSlice<T> chunk) {
+    if (chunk.empty()) {
+      // empty chunks would break the strictly increasing starts_
+      return;
+    }
+    starts_.push_back(starts_.back() + chunk.size());
+    chunks_.push_back(std::move(chunk));
+  }
+
+  auto name() const noexcept -> std::string_view { return name_; }
+  [[nodiscard]] auto type_format() const noexcept -> std::string const & {
+    return format_;
+  }
+  [[nodiscard]] auto size() const noexcept -> size_t { return starts_.back(); }
+  [[nodiscard]] auto empty() const noexcept -> bool { return size() == 0; }
+  [[nodiscard]] auto num_chunks() const noexcept -> size_t {
+    return chunks_.size();
+  }
+  [[nodiscard]] auto chunk(size_t const index) const -> XArrowSlice<T> const & {
+    return chunks_.at(index);
+  }
+
+  auto operator[](size_t const pos) const noexcept -> T const & {
+    auto const [c, i] = locate(pos);
+    return chunks_[c][i];
+  }
+  auto at(size_t const pos) const -> T const & {
+    if (pos >= size()) [[unlikely]] {
+      throw std::out_of_range("ChunkedColumn::at: pos out of range");
+    }
+    return (*this)[pos];
+  }
+
+  /**
+   * @brief zero-copy view of [offset, offset + length)
+   * Costs O(log chunks) plus one slice per chunk touched.
+   */
+  [[nodiscard]] auto slice(size_t const offset, size_t length) const
+      -> ChunkedColumn {
+    if (offset > size() || length > size() - offset) [[unlikely]] {
+      throw std::out_of_range("ChunkedColumn::slice: window out of range");
+    }
+    ChunkedColumn result(*this, 0);
+    if (length == 0) {
+      return result;
+    }
+    auto [c, i] = locate(offset);
+    while (length > 0) {
+      auto const take = std::min(length, chunks_[c].size() - i);
+      result.append(chunks_[c].slice(i, take));
+      length -= take;
+      i = 0;
+      ++c;
+    }
+    return result;
+  }
+
+  /**
+   * @brief export as an ArrowArrayStream yielding one array per chunk
+   * The stream holds its own references to the chunks, so this column may
+   * be destroyed while the stream is still being consumed.
+   */
+  void to_stream_move(ArrowArrayStream &stream) const {
+    stream.get_schema = [](struct ArrowArrayStream *now,
+                           struct ArrowSchema *out) -> int {
+      auto const &column =
+          static_cast<StreamState *>(now->private_data)->column;
+      try {
+        detail::schema_move(*out, column.format_, column.name_);
+      } catch (...) {
+        return ENOMEM;
+      }
+      return 0;
+    };
+    stream.get_next = [](struct ArrowArrayStream *now,
+                         struct ArrowArray *out) -> int {
+      auto &state = *static_cast<StreamState *>(now->private_data);
+      if (state.next == state.column.num_chunks()) {
+        out->release = nullptr;
+        return 0;
+      }
+      try {
+        state.column.chunks_[state.next].to_array_move(*out);
+      } catch (...) {
+        return ENOMEM;
+      }
+      ++state.next;
+      return 0;
+    };
+    stream.get_last_error = [](struct ArrowArrayStream * /*unused*/)
+        -> const char * { return nullptr; };
+    stream.release = [](struct ArrowArrayStream *now) {
+      delete static_cast<StreamState *>(now->private_data);
+      now->release = nullptr;
+    };
+    stream.private_data = new StreamState{*this, 0};
+  }
+
+private:
+  struct StreamState {
+    ChunkedColumn column;
+    size_t next;
+  };
+
+  // empty column sharing name and format
+  ChunkedColumn(ChunkedColumn const &other, int /*unused*/)
+      : name_(other.name_), format_(other.format_), starts_{0} {}
+
+  std::string name_;
+  std::string format_;
+  std::vector<XArrowSlice<T>> chunks_;
+  // starts_[i] is the logical position of chunks_[i][0], back() is the size
+  std::vector<size_t> starts_;
+
+  [[nodiscard]] auto locate(size_t const pos) const noexcept
+      -> std::pair<size_t, size_t> {
+    auto const it = std::upper_bound(starts_.begin(), starts_.end(), pos);
+    auto const c = static_cast<size_t>(it - starts_.begin()) - 1;
+    return {c, pos - starts_[c]};
+  }
+};
 } // namespace xarrow
@@ -0,0 +1,20 @@
+#!/usr/bin/env python3
+# Dump test/data/golden.parquet through pyarrow into test/data/golden.csv.
+#
+# golden.parquet is what ParquetWriter produces in the "parquet output
+# matches the golden file" test. Whenever the writer's output changes on
+# purpose, write the test's columns to it again and rerun this script: the
+# test then checks the new bytes against what an independent reader made of
+# them.
+import os
+import sys
+
+import pyarrow.csv
+import pyarrow.parquet
+
+data = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "test",
+                    "data")
+table = pyarrow.parquet.read_table(os.path.join(data, "golden.parquet"))
+if table.num_rows == 0:
+    sys.exit("golden.parquet has no rows")
+pyarrow.csv.write_csv(table, os.path.join(data, "golden.csv"))
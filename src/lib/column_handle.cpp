@@ -0,0 +1,52 @@
+#include "column_handle.hpp"
+#include "common.hpp"
+
+namespace xarrow {
+namespace detail {
+template <class T>
+static auto variant_handle(XArrowVariant const &column) -> ColumnHandle {
+  return column_handle(*std::get_if<XArrowNonNull<T>>(&column));
+}
+
+template <class T, Type type>
+constexpr static bool alternative_is_v = std::is_same_v<
+    std::variant_alternative_t<static_cast<size_t>(type), XArrowVariant>,
+    XArrowNonNull<T>>;
+} // namespace detail
+
+// the handles table relies on XArrowVariant listing its alternatives in
+// types.def order, like Type
+static_assert(std::variant_size_v<XArrowVariant> == type_count);
+#define OPT(type, enum_name, format_str)                                       \
+  static_assert(detail::alternative_is_v<type, Type::enum_name>,               \
+                "XArrowVariant alternative out of types.def order");
+#define END(type, enum_name, format_str) OPT(type, enum_name, format_str)
+#include "types.def"
+#undef OPT
+#undef END
+
+auto column_handle(XArrowVariant const &column) -> ColumnHandle {
+  if (column.valueless_by_exception()) [[unlikely]] {
+    throw std::bad_variant_access();
+  }
+  using Handle = ColumnHandle (*)(XArrowVariant const &);
+  constexpr static std::array<Handle, type_count> handles{
+#define OPT(type, enum_name, format_str) &detail::variant_handle<type>,
+#define END(type, enum_name, format_str) &detail::variant_handle<type>
+#include "types.def"
+#undef OPT
+#undef END
+  };
+  return handles[column.index()](column);
+}
+
+auto column_handles(std::vector<XArrowVariant> const &columns)
+    -> std::vector<ColumnHandle> {
+  std::vector<ColumnHandle> handles;
+  handles.reserve(columns.size());
+  for (auto const &column : columns) {
+    handles.push_back(column_handle(column));
+  }
+  return handles;
+}
+} // namespace xarrow
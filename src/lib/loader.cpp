@@ -0,0 +1,768 @@
+#include "loader.hpp"
+#include "column_handle.hpp"
+#include "common.hpp"
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+namespace xarrow {
+namespace detail {
+using IoBuffer = AlignedBuffer<direct_alignment>;
+
+static auto sys_error(const char *what, int const err = errno)
+    -> std::system_error {
+  return {err, std::generic_category(), what};
+}
+
+struct FileHandle {
+  FileHandle(const char *path, bool const direct) {
+    if (direct) {
+      fd = open(path, O_RDONLY | O_CLOEXEC | O_DIRECT);
+      // e.g. tmpfs refuses O_DIRECT, buffered reads still work there
+      if (fd >= 0 || errno != EINVAL) {
+        this->direct = fd >= 0;
+      }
+    }
+    if (fd < 0) {
+      fd = open(path, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+      throw sys_error("open");
+    }
+  }
+  FileHandle(const FileHandle &) = delete;
+  auto operator=(const FileHandle &) -> FileHandle & = delete;
+  FileHandle(FileHandle &&) = delete;
+  auto operator=(FileHandle &&) -> FileHandle & = delete;
+  ~FileHandle() { close(fd); }
+
+  [[nodiscard]] auto size() const -> size_t {
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+      throw sys_error("fstat");
+    }
+    return static_cast<size_t>(st.st_size);
+  }
+
+  int fd = -1;
+  bool direct = false;
+};
+
+/**
+ * @brief chunk k covers [k * chunk_bytes, min(size, (k + 1) * chunk_bytes))
+ */
+struct ChunkPlan {
+  size_t file_bytes;
+  size_t chunk_bytes;
+  size_t n_chunks;
+
+  [[nodiscard]] auto offset(size_t const k) const noexcept -> size_t {
+    return k * chunk_bytes;
+  }
+  [[nodiscard]] auto expected(size_t const k) const noexcept -> size_t {
+    return std::min(chunk_bytes, file_bytes - offset(k));
+  }
+  // what the first read of chunk k asks for, block sized for O_DIRECT
+  [[nodiscard]] auto request(size_t const k) const noexcept -> size_t {
+    return std::min(chunk_bytes, align_round(expected(k), direct_alignment));
+  }
+};
+
+/**
+ * @brief where chunk k lands: its place in target, or a recycled slot
+ */
+struct ChunkTarget {
+  std::byte *target;
+  std::vector<IoBuffer> slots;
+
+  ChunkTarget(std::byte *const target, ChunkPlan const &plan,
+              size_t const depth)
+      : target(target) {
+    if (target == nullptr) {
+      slots.reserve(depth);
+      for (size_t i = 0; i < depth; ++i) {
+        slots.emplace_back(plan.chunk_bytes);
+      }
+    }
+  }
+
+  [[nodiscard]] auto buffer(ChunkPlan const &plan, size_t const k)
+      -> std::byte * {
+    return target != nullptr
+               ? target + plan.offset(k)
+               : static_cast<std::byte *>(slots[k % slots.size()].data());
+  }
+};
+
+/**
+ * @brief finish a chunk that came back short, 0 bytes means EOF
+ * Requests stay block sized so that O_DIRECT accepts them. Under O_DIRECT
+ * they resume from the last block boundary, rereading its head, so buffer
+ * address, file offset and length all stay aligned.
+ */
+static auto read_rest(FileHandle const &file, std::byte *buf, size_t done,
+                      size_t const expected, size_t const offset) -> size_t {
+  while (done < expected) {
+    auto const from = file.direct ? done - done % direct_alignment : done;
+    auto const want = file.direct
+                          ? align_round(expected - from, direct_alignment)
+                          : expected - from;
+    auto const n = pread(file.fd, buf + from, want,
+                         static_cast<off_t>(offset + from));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw sys_error("pread");
+    }
+    auto const end = from + static_cast<size_t>(n);
+    // nothing past what we already had, the file ended early
+    if (end <= done) {
+      break;
+    }
+    done = end;
+  }
+  return std::min(done, expected);
+}
+
+/**
+ * @brief minimal io_uring wrapper over the raw syscalls
+ * Only ever touched from the decoding thread.
+ */
+class Uring {
+public:
+  explicit Uring(unsigned const entries) {
+    io_uring_params params{};
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      throw sys_error("io_uring_setup");
+    }
+    sq_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    single_mmap_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap_) {
+      sq_bytes_ = cq_bytes_ = std::max(sq_bytes_, cq_bytes_);
+    }
+    sqe_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    try {
+      sq_ = map(sq_bytes_, IORING_OFF_SQ_RING);
+      cq_ = single_mmap_ ? sq_ : map(cq_bytes_, IORING_OFF_CQ_RING);
+      sqes_ = static_cast<io_uring_sqe *>(map(sqe_bytes_, IORING_OFF_SQES));
+    } catch (...) {
+      teardown();
+      throw;
+    }
+
+    auto *sq = static_cast<std::byte *>(sq_);
+    auto *cq = static_cast<std::byte *>(cq_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail); // NOLINT
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  }
+  Uring(const Uring &) = delete;
+  auto operator=(const Uring &) -> Uring & = delete;
+  Uring(Uring &&) = delete;
+  auto operator=(Uring &&) -> Uring & = delete;
+  ~Uring() { teardown(); }
+
+  void submit_read(int const fd, void *buf, unsigned const len,
+                   uint64_t const offset, uint64_t const user_data) {
+    auto const tail = *sq_tail_;
+    auto const index = tail & sq_mask_;
+    auto &sqe = sqes_[index];
+    sqe = io_uring_sqe{};
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(buf); // NOLINT
+    sqe.len = len;
+    sqe.off = offset;
+    sqe.user_data = user_data;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    enter(1, 0, 0);
+    ++in_flight_;
+  }
+
+  /**
+   * @brief block until one read completes
+   * @return {user_data, res}
+   */
+  auto wait() -> std::pair<uint64_t, int32_t> {
+    while (true) {
+      auto const head = *cq_head_;
+      if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        auto const &cqe = cqes_[head & cq_mask_];
+        std::pair<uint64_t, int32_t> const result{cqe.user_data, cqe.res};
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        --in_flight_;
+        return result;
+      }
+      enter(0, 1, IORING_ENTER_GETEVENTS);
+    }
+  }
+
+  /**
+   * @brief wait out every read still targeting our buffers
+   */
+  void drain() noexcept {
+    try {
+      while (in_flight_ > 0) {
+        wait();
+      }
+    } catch (...) {
+      // ring is broken, nothing sensible left to do
+      std::terminate();
+    }
+  }
+
+private:
+  auto map(size_t const bytes, off_t const offset) const -> void * {
+    auto *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, offset);
+    if (p == MAP_FAILED) {
+      throw sys_error("mmap");
+    }
+    return p;
+  }
+  void teardown() noexcept {
+    unmap(sqes_, sqe_bytes_);
+    if (!single_mmap_) {
+      unmap(cq_, cq_bytes_);
+    }
+    unmap(sq_, sq_bytes_);
+    close(fd_);
+  }
+  static void unmap(void *p, size_t const bytes) noexcept {
+    if (p != nullptr) {
+      munmap(p, bytes);
+    }
+  }
+  void enter(unsigned const to_submit, unsigned const min_complete,
+             unsigned const flags) const {
+    while (syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags,
+                   nullptr, 0) < 0) {
+      if (errno != EINTR) {
+        throw sys_error("io_uring_enter");
+      }
+    }
+  }
+
+  int fd_ = -1;
+  bool single_mmap_ = false;
+  size_t sq_bytes_ = 0;
+  size_t cq_bytes_ = 0;
+  size_t sqe_bytes_ = 0;
+  void *sq_ = nullptr;
+  void *cq_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  size_t in_flight_ = 0;
+};
+
+/**
+ * @brief stream the file through the ring
+ * With fallback set, a kernel refusing the read opcode itself (-EINVAL or
+ * -EOPNOTSUPP before any chunk was delivered) returns false instead of
+ * throwing, so the caller can switch to threads.
+ */
+static auto read_uring(Uring &ring, FileHandle const &file,
+                       ChunkPlan const &plan, size_t const depth,
+                       bool const fallback, std::byte *const target,
+                       ChunkCallback const &on_chunk) -> bool {
+  ChunkTarget buffers(target, plan, depth);
+  // bytes read for the chunk currently owning each slot, -1 while pending
+  std::vector<int64_t> ready(depth, -1);
+  size_t next_submit = 0;
+  auto submit = [&]() {
+    ring.submit_read(file.fd, buffers.buffer(plan, next_submit),
+                     static_cast<unsigned>(plan.request(next_submit)),
+                     plan.offset(next_submit), next_submit);
+    ++next_submit;
+  };
+
+  auto const unsupported = [&](size_t const delivered, int const err) {
+    return fallback && delivered == 0 && (err == EINVAL || err == EOPNOTSUPP);
+  };
+
+  try {
+    while (next_submit < std::min(depth, plan.n_chunks)) {
+      try {
+        submit();
+      } catch (std::system_error const &e) {
+        if (!unsupported(0, e.code().value())) {
+          throw;
+        }
+        ring.drain();
+        return false;
+      }
+    }
+    for (size_t k = 0; k < plan.n_chunks; ++k) {
+      auto const slot = k % depth;
+      while (ready[slot] < 0) {
+        auto const [chunk, res] = ring.wait();
+        if (unsupported(k, -res)) {
+          ring.drain();
+          return false;
+        }
+        if (res < 0) {
+          throw sys_error("io_uring read", -res);
+        }
+        ready[chunk % depth] = static_cast<int64_t>(read_rest(
+            file, buffers.buffer(plan, chunk), static_cast<size_t>(res),
+            plan.expected(chunk), plan.offset(chunk)));
+      }
+      on_chunk(buffers.buffer(plan, k), static_cast<size_t>(ready[slot]));
+      ready[slot] = -1;
+      if (next_submit < plan.n_chunks) {
+        submit();
+      }
+    }
+  } catch (...) {
+    ring.drain();
+    throw;
+  }
+  return true;
+}
+
+static void read_threads(FileHandle const &file, ChunkPlan const &plan,
+                         size_t const depth, std::byte *const target,
+                         ChunkCallback const &on_chunk) {
+  struct Slot {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool full = false;
+    size_t bytes = 0;
+    std::exception_ptr error;
+  };
+  std::vector<Slot> slots(depth);
+  ChunkTarget buffers(target, plan, depth);
+  std::atomic<bool> stop{false};
+
+  // worker t owns slot t and reads chunks t, t + depth, ...
+  auto worker = [&](size_t const t) {
+    auto &slot = slots[t];
+    for (size_t k = t; k < plan.n_chunks; k += depth) {
+      {
+        std::unique_lock lock(slot.mutex);
+        slot.cv.wait(lock, [&] { return !slot.full || stop.load(); });
+        if (stop.load()) {
+          return;
+        }
+      }
+      size_t bytes = 0;
+      std::exception_ptr error;
+      try {
+        bytes = read_rest(file, buffers.buffer(plan, k), 0, plan.expected(k),
+                          plan.offset(k));
+      } catch (...) {
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard lock(slot.mutex);
+        slot.bytes = bytes;
+        slot.error = error;
+        slot.full = true;
+      }
+      slot.cv.notify_all();
+      if (error) {
+        return;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  auto join = [&]() {
+    stop.store(true);
+    for (auto &slot : slots) {
+      std::lock_guard lock(slot.mutex);
+      slot.cv.notify_all();
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+
+  try {
+    for (size_t t = 0; t < std::min(depth, plan.n_chunks); ++t) {
+      threads.emplace_back(worker, t);
+    }
+    for (size_t k = 0; k < plan.n_chunks; ++k) {
+      auto &slot = slots[k % depth];
+      {
+        std::unique_lock lock(slot.mutex);
+        slot.cv.wait(lock, [&] { return slot.full; });
+        if (slot.error) {
+          std::rethrow_exception(slot.error);
+        }
+      }
+      on_chunk(buffers.buffer(plan, k), slot.bytes);
+      {
+        std::lock_guard lock(slot.mutex);
+        slot.full = false;
+      }
+      slot.cv.notify_all();
+    }
+  } catch (...) {
+    join();
+    throw;
+  }
+  join();
+}
+
+static void check(LoadOptions const &options) {
+  if (options.chunk_bytes == 0 || options.queue_depth == 0) {
+    throw std::invalid_argument("read_chunks: empty chunk or queue");
+  }
+}
+
+/**
+ * @brief the first bytes of file, into target or recycled slots
+ */
+static auto read_file(FileHandle const &file, size_t const bytes,
+                      LoadOptions const &options, std::byte *const target,
+                      ChunkCallback const &on_chunk) -> IoBackend {
+  auto const chunk_bytes = align_round(options.chunk_bytes, direct_alignment);
+  ChunkPlan const plan{bytes, chunk_bytes,
+                       (bytes + chunk_bytes - 1) / chunk_bytes};
+  auto const depth = options.queue_depth;
+
+  if (options.backend != IoBackend::THREADS) {
+    std::unique_ptr<Uring> ring;
+    try {
+      ring = std::make_unique<Uring>(static_cast<unsigned>(depth));
+    } catch (std::system_error const &) {
+      // old kernel or seccomp filtered, fall through to threads
+      if (options.backend == IoBackend::IO_URING) {
+        throw;
+      }
+    }
+    // AUTO also falls back when the ring exists but refuses reads
+    if (ring != nullptr &&
+        read_uring(*ring, file, plan, depth,
+                   options.backend == IoBackend::AUTO, target, on_chunk)) {
+      return IoBackend::IO_URING;
+    }
+  }
+  read_threads(file, plan, depth, target, on_chunk);
+  return IoBackend::THREADS;
+}
+
+// one field of a CSV line, without the surrounding blanks
+struct CsvField {
+  const char *first;
+  const char *last;
+};
+
+// rows split per parse call, a batch of fields stays in cache
+constexpr size_t csv_batch_rows = 4096;
+
+// one per CSV column, typed entry points into its AlignedVector
+struct CsvSink {
+  void *column;
+  // row i's field is fields[i * stride], returns the rows it appended
+  auto (*parse)(void *column, CsvField const *fields, size_t stride,
+                size_t rows) -> size_t;
+  void (*reserve)(void *column, size_t rows);
+};
+
+template <class T>
+auto parse_number(const char *first, const char *last, T &value) -> bool {
+  auto const [ptr, ec] = std::from_chars(first, last, value);
+  return ec == std::errc() && ptr == last;
+}
+
+// YYYY-MM-DD, falling back to a plain day count
+static auto parse_date(const char *first, const char *last, int32_t &value)
+    -> bool {
+  if (last - first != 10 || first[4] != '-' || first[7] != '-') {
+    return parse_number(first, last, value);
+  }
+  int year = 0;
+  unsigned month = 0;
+  unsigned day = 0;
+  if (!parse_number(first, first + 4, year) ||
+      !parse_number(first + 5, first + 7, month) ||
+      !parse_number(first + 8, last, day) || month < 1 || month > 12 ||
+      day < 1 || day > 31) {
+    return false;
+  }
+  value = static_cast<int32_t>(days_from_civil(year, month, day));
+  return true;
+}
+
+template <class T>
+auto parse_value(const char *first, const char *last, T &value) -> bool {
+  if constexpr (std::is_same_v<T, Date32>) {
+    return parse_date(first, last, value.value);
+  } else if constexpr (std::is_same_v<T, Date64> ||
+                       std::is_same_v<T, Timestamp> ||
+                       std::is_same_v<T, Duration>) {
+    return parse_number(first, last, value.value);
+  } else if constexpr (std::is_same_v<T, bool>) {
+    std::string_view const field(first, last - first);
+    value = field == "1" || field == "true";
+    return value || field == "0" || field == "false";
+  } else {
+    return parse_number(first, last, value);
+  }
+}
+
+template <class T>
+auto parse_fields(void *column, CsvField const *fields, size_t const stride,
+                  size_t const rows) -> size_t {
+  auto &data = *static_cast<AlignedVector<T, alignment> *>(column);
+  auto const old = data.size();
+  data.resize_uninitialized(old + rows);
+  auto *out = data.data() + old;
+  for (size_t i = 0; i < rows; ++i) {
+    auto const &field = fields[i * stride];
+    if (!parse_value(field.first, field.last, out[i])) {
+      data.resize_uninitialized(old + i);
+      return i;
+    }
+  }
+  return rows;
+}
+
+template <class T> void reserve_rows(void *column, size_t const rows) {
+  static_cast<AlignedVector<T, alignment> *>(column)->reserve(rows);
+}
+
+/**
+ * @brief appends the spec's column to result and returns its sink
+ * Resolved once per column with kernel_for, no std::visit involved.
+ */
+template <class T> struct CsvColumnKernel {
+  static auto run(CsvColumn const &spec, std::vector<XArrowVariant> &result)
+      -> CsvSink {
+    if constexpr (std::is_same_v<T, Decimal128> ||
+                  std::is_same_v<T, Decimal256>) {
+      throw std::invalid_argument("load_csv: decimal columns are unsupported");
+    } else {
+      constexpr auto tag = std::in_place_type<XArrowNonNull<T>>;
+      if constexpr (is_parameterized_v<T>) {
+        result.emplace_back(tag, spec.name, spec.format);
+      } else {
+        result.emplace_back(tag, spec.name);
+      }
+      auto &column = std::get<XArrowNonNull<T>>(result.back());
+      return {&column.detach(), &parse_fields<T>, &reserve_rows<T>};
+    }
+  }
+};
+
+/**
+ * @brief splits lines into fields, then parses them a column at a time
+ */
+class CsvParser {
+public:
+  CsvParser(std::vector<CsvSink> sinks, CsvOptions const &options)
+      : sinks_(std::move(sinks)), options_(options),
+        skip_header_(options.header) {}
+
+  void feed(const char *data, size_t const size) {
+    const char *p = data;
+    const char *const end = data + size;
+    if (!carry_.empty()) {
+      const auto *nl = static_cast<const char *>(std::memchr(p, '\n', size));
+      if (nl == nullptr) {
+        carry_.append(p, end);
+        return;
+      }
+      carry_.append(p, nl);
+      split_line(carry_.data(), carry_.data() + carry_.size());
+      p = nl + 1;
+    }
+    const char *rest = end;
+    while (p < end) {
+      const auto *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+      if (nl == nullptr) {
+        // line continues in the next chunk
+        rest = p;
+        break;
+      }
+      split_line(p, nl);
+      p = nl + 1;
+    }
+    // the fields point into carry_ and data until they are parsed
+    parse_batch();
+    carry_.assign(rest, end);
+  }
+
+  void finish() {
+    if (!carry_.empty()) {
+      split_line(carry_.data(), carry_.data() + carry_.size());
+      parse_batch();
+      carry_.clear();
+    }
+  }
+
+  [[nodiscard]] auto rows() const noexcept -> size_t { return rows_; }
+
+private:
+  static auto trim(const char *&first, const char *&last) {
+    while (first < last && (*first == ' ' || *first == '\t')) {
+      ++first;
+    }
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t')) {
+      --last;
+    }
+  }
+
+  void split_line(const char *first, const char *last) {
+    ++line_;
+    if (last > first && last[-1] == '\r') {
+      --last;
+    }
+    if (first == last) {
+      return;
+    }
+    if (skip_header_) {
+      skip_header_ = false;
+      return;
+    }
+    const char *p = first;
+    for (size_t c = 0; c < sinks_.size(); ++c) {
+      const char *field_end = last;
+      if (c + 1 < sinks_.size()) {
+        field_end = static_cast<const char *>(
+            std::memchr(p, options_.delimiter, last - p));
+        if (field_end == nullptr) {
+          // earlier lines may hold the first error
+          fields_.resize(lines_.size() * sinks_.size());
+          parse_batch();
+          fail("too few fields", line_);
+        }
+      }
+      CsvField field{p, field_end};
+      trim(field.first, field.last);
+      fields_.push_back(field);
+      p = field_end + 1;
+    }
+    lines_.push_back(line_);
+    if (lines_.size() == csv_batch_rows) {
+      parse_batch();
+    }
+  }
+
+  // one kernel call per column, each stops at its first bad field
+  void parse_batch() {
+    auto rows = lines_.size();
+    for (size_t c = 0; c < sinks_.size() && rows > 0; ++c) {
+      rows = sinks_[c].parse(sinks_[c].column, fields_.data() + c,
+                             sinks_.size(), rows);
+    }
+    if (rows < lines_.size()) {
+      fail("bad value", lines_[rows]);
+    }
+    rows_ += rows;
+    fields_.clear();
+    lines_.clear();
+  }
+
+  [[noreturn]] static void fail(const char *what, size_t const line) {
+    throw std::runtime_error(std::string("load_csv: ") + what + " at line " +
+                             std::to_string(line));
+  }
+
+  std::vector<CsvSink> sinks_;
+  CsvOptions options_;
+  bool skip_header_;
+  std::string carry_;
+  // fields of the split but unparsed rows, row-major, and their lines
+  std::vector<CsvField> fields_;
+  std::vector<size_t> lines_;
+  size_t line_ = 0;
+  size_t rows_ = 0;
+};
+} // namespace detail
+
+auto file_size(const char *path) -> size_t {
+  return detail::FileHandle(path, false).size();
+}
+
+auto read_chunks(const char *path, LoadOptions const &options,
+                 ChunkCallback const &on_chunk) -> IoBackend {
+  detail::check(options);
+  detail::FileHandle const file(path, options.direct);
+  return detail::read_file(file, file.size(), options, nullptr, on_chunk);
+}
+
+auto read_into(const char *path, std::byte *dst, size_t const size,
+               LoadOptions const &options) -> size_t {
+  detail::check(options);
+  // O_DIRECT transfers straight into dst, which must be aligned for it
+  auto const aligned =
+      reinterpret_cast<uintptr_t>(dst) % direct_alignment == 0; // NOLINT
+  detail::FileHandle const file(path, options.direct && aligned);
+  auto const chunk_bytes = align_round(options.chunk_bytes, direct_alignment);
+  size_t done = 0;
+  bool short_chunk = false;
+  detail::read_file(file, std::min(size, file.size()), options, dst,
+                    [&](const std::byte * /*chunk*/, size_t const bytes) {
+                      // only the last chunk may come back short
+                      if (short_chunk) {
+                        throw std::runtime_error(
+                            "read_into: file shrank while loading");
+                      }
+                      short_chunk = bytes < chunk_bytes;
+                      done += bytes;
+                    });
+  return done;
+}
+
+auto load_csv(const char *path, std::vector<CsvColumn> const &columns,
+              CsvOptions const &csv, LoadOptions const &options)
+    -> std::vector<XArrowVariant> {
+  if (columns.empty()) {
+    throw std::invalid_argument("load_csv: no columns");
+  }
+  std::vector<XArrowVariant> result;
+  std::vector<detail::CsvSink> sinks;
+  result.reserve(columns.size());
+  for (auto const &column : columns) {
+    if (static_cast<size_t>(column.type) >= type_count) {
+      throw std::runtime_error("Unsupported Type");
+    }
+    sinks.push_back(
+        kernel_for<detail::CsvColumnKernel>(column.type)(column, result));
+  }
+
+  auto const bytes = file_size(path);
+  detail::CsvParser parser(sinks, csv);
+  bool reserved = false;
+  read_chunks(path, options, [&](const std::byte *chunk, size_t const size) {
+    parser.feed(reinterpret_cast<const char *>(chunk), size); // NOLINT
+    if (!reserved && parser.rows() > 0 && size < bytes) {
+      // extrapolate the row count from the first chunk to avoid regrowth
+      auto const estimate = parser.rows() * (bytes / size + 1);
+      for (auto const &sink : sinks) {
+        sink.reserve(sink.column, estimate);
+      }
+      reserved = true;
+    }
+  });
+  parser.finish();
+  return result;
+}
+} // namespace xarrow
@@ -0,0 +1,113 @@
+#include "metrics.hpp"
+#include "common.hpp"
+#include <memory>
+#include <mutex>
+
+namespace xarrow {
+namespace metrics {
+namespace detail {
+struct Registry {
+  Registry() { retired.shared = true; }
+
+  std::mutex mutex;
+  std::vector<ThreadCounters *> live;
+  // totals of threads that already exited, and of their late updates
+  ThreadCounters retired;
+};
+
+// set once the thread's slot is destroyed, it is never recreated
+static thread_local bool slot_gone = false;
+
+// never destroyed, threads may exit after static destruction started;
+// built in static storage, so the fallback for a failed slot cannot throw
+static auto registry() noexcept -> Registry & {
+  alignas(Registry) static std::array<std::byte, sizeof(Registry)> storage;
+  static auto *instance = new (storage.data()) Registry();
+  return *instance;
+}
+
+template <class V, size_t N>
+static void accumulate(std::array<V, N> &out,
+                       std::array<std::atomic<V>, N> const &in) {
+  for (size_t i = 0; i < N; ++i) {
+    out[i] += in[i].load(std::memory_order_relaxed);
+  }
+}
+
+template <class V, size_t N>
+static void fold(std::array<std::atomic<V>, N> &out,
+                 std::array<std::atomic<V>, N> const &in) {
+  for (size_t i = 0; i < N; ++i) {
+    bump(out[i], in[i].load(std::memory_order_relaxed), true);
+  }
+}
+
+ThreadSlot::ThreadSlot() {
+  auto owned = std::make_unique<ThreadCounters>();
+  auto &reg = registry();
+  {
+    std::lock_guard<std::mutex> const lock(reg.mutex);
+    reg.live.push_back(owned.get());
+  }
+  counters = owned.release();
+  thread_counters = counters;
+}
+
+ThreadSlot::~ThreadSlot() {
+  thread_counters = nullptr;
+  slot_gone = true;
+  auto &reg = registry();
+  {
+    std::lock_guard<std::mutex> const lock(reg.mutex);
+    fold(reg.retired.counters, counters->counters);
+    fold(reg.retired.allocation_bytes, counters->allocation_bytes);
+    fold(reg.retired.kernel_ps_per_row, counters->kernel_ps_per_row);
+    reg.live.erase(std::find(reg.live.begin(), reg.live.end(), counters));
+  }
+  delete counters;
+}
+
+auto attach_thread() noexcept -> ThreadCounters & {
+  try {
+    if (!slot_gone) [[likely]] {
+      thread_local ThreadSlot slot;
+      return *slot.counters;
+    }
+  } catch (...) {
+    // no memory for a slot, the next call tries again
+  }
+  return registry().retired;
+}
+} // namespace detail
+
+auto counter_name(Counter const counter) -> const char * {
+  switch (counter) {
+#define XARROW_COUNTER_CASE(e, name)                                           \
+  case Counter::e:                                                             \
+    return #name;
+    XARROW_COUNTERS(XARROW_COUNTER_CASE)
+#undef XARROW_COUNTER_CASE
+  default:
+    throw std::runtime_error("Unsupported Counter");
+  }
+}
+
+auto snapshot() -> Snapshot {
+  Snapshot result;
+#if XARROW_METRICS
+  auto &reg = detail::registry();
+  std::lock_guard<std::mutex> const lock(reg.mutex);
+  auto add_thread = [&result](detail::ThreadCounters const &counters) {
+    detail::accumulate(result.counters, counters.counters);
+    detail::accumulate(result.allocation_bytes, counters.allocation_bytes);
+    detail::accumulate(result.kernel_ps_per_row, counters.kernel_ps_per_row);
+  };
+  add_thread(reg.retired);
+  for (auto const *counters : reg.live) {
+    add_thread(*counters);
+  }
+#endif
+  return result;
+}
+} // namespace metrics
+} // namespace xarrow
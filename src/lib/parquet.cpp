@@ -0,0 +1,1138 @@
+#include "parquet.hpp"
+#include "common.hpp"
+#include "stats.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#ifdef XARROW_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace xarrow {
+namespace detail {
+// Thrift compact protocol, just what the footer and page headers need
+class ThriftWriter {
+public:
+  enum : uint8_t {
+    BOOL_TRUE = 1,
+    BOOL_FALSE = 2,
+    BYTE = 3,
+    I32 = 5,
+    I64 = 6,
+    BINARY = 8,
+    LIST = 9,
+    STRUCT = 12,
+  };
+
+  explicit ThriftWriter(std::string &out) : out_(out) {}
+
+  void i32(int16_t const id, int32_t const value) {
+    field(id, I32);
+    varint(zigzag(value));
+  }
+  void i64(int16_t const id, int64_t const value) {
+    field(id, I64);
+    varint(zigzag(value));
+  }
+  void boolean(int16_t const id, bool const value) {
+    field(id, value ? BOOL_TRUE : BOOL_FALSE);
+  }
+  void byte(int16_t const id, int8_t const value) {
+    field(id, BYTE);
+    out_.push_back(static_cast<char>(value));
+  }
+  void binary(int16_t const id, std::string_view const value) {
+    field(id, BINARY);
+    element_binary(value);
+  }
+  void begin_struct(int16_t const id) {
+    field(id, STRUCT);
+    ids_.push_back(0);
+  }
+  void end_struct() {
+    out_.push_back(0);
+    ids_.pop_back();
+  }
+  void begin_list(int16_t const id, uint8_t const element_type,
+                  size_t const size) {
+    field(id, LIST);
+    if (size < 15) {
+      out_.push_back(static_cast<char>(size << 4 | element_type));
+    } else {
+      out_.push_back(static_cast<char>(0xf0 | element_type));
+      varint(size);
+    }
+  }
+  void element_i32(int32_t const value) { varint(zigzag(value)); }
+  void element_binary(std::string_view const value) {
+    varint(value.size());
+    out_.append(value);
+  }
+  // a struct list element, closed by end_struct()
+  void begin_element() { ids_.push_back(0); }
+  // stop field of the outermost struct
+  void finish() { out_.push_back(0); }
+
+private:
+  static auto zigzag(int64_t const v) noexcept -> uint64_t {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+  }
+  void varint(uint64_t v) {
+    for (; v >= 0x80; v >>= 7) {
+      out_.push_back(static_cast<char>(v | 0x80));
+    }
+    out_.push_back(static_cast<char>(v));
+  }
+  void field(int16_t const id, uint8_t const type) {
+    auto const delta = id - ids_.back();
+    if (delta > 0 && delta <= 15) {
+      out_.push_back(static_cast<char>(delta << 4 | type));
+    } else {
+      out_.push_back(static_cast<char>(type));
+      varint(zigzag(id));
+    }
+    ids_.back() = id;
+  }
+
+  std::string &out_;
+  std::vector<int16_t> ids_{0};
+};
+
+// parquet.thrift constants
+namespace pq {
+enum PhysicalType : int32_t {
+  BOOLEAN = 0,
+  INT32 = 1,
+  INT64 = 2,
+  FLOAT = 4,
+  DOUBLE = 5,
+  FIXED_LEN_BYTE_ARRAY = 7,
+};
+enum ConvertedType : int32_t {
+  NO_CONVERTED_TYPE = -1,
+  DECIMAL = 5,
+  DATE = 6,
+  TIMESTAMP_MILLIS = 9,
+  TIMESTAMP_MICROS = 10,
+  UINT_8 = 11,
+  INT_8 = 15,
+};
+// LogicalType union members
+enum LogicalType : int16_t {
+  NO_LOGICAL_TYPE = -1,
+  LOGICAL_DECIMAL = 5,
+  LOGICAL_DATE = 6,
+  LOGICAL_TIMESTAMP = 8,
+  LOGICAL_INTEGER = 10,
+};
+enum Encoding : int32_t { PLAIN = 0, RLE = 3, RLE_DICTIONARY = 8 };
+enum PageType : int32_t { DATA_PAGE = 0, DICTIONARY_PAGE = 2 };
+constexpr int32_t REQUIRED = 0;
+} // namespace pq
+
+struct ColumnType {
+  int32_t physical = pq::BOOLEAN;
+  int32_t type_length = 0;
+  int32_t converted = pq::NO_CONVERTED_TYPE;
+  int16_t logical = pq::NO_LOGICAL_TYPE;
+  int32_t scale = 0;
+  int32_t precision = 0;
+  int8_t bit_width = 0;
+  bool is_signed = false;
+  bool utc = false;
+  // TimeUnit union member: 1 millis, 2 micros, 3 nanos
+  int16_t unit = 0;
+};
+
+template <class T> constexpr static bool parquet_supported_v =
+    !std::is_same_v<T, Date64> && !std::is_same_v<T, Duration> &&
+    !std::is_same_v<T, Decimal256>;
+
+static auto integer_type(int const bits, bool const is_signed)
+    -> ColumnType {
+  ColumnType type;
+  type.physical = bits == 64 ? pq::INT64 : pq::INT32;
+  auto const log = bits == 8 ? 0 : bits == 16 ? 1 : bits == 32 ? 2 : 3;
+  type.converted = (is_signed ? pq::INT_8 : pq::UINT_8) + log;
+  type.logical = pq::LOGICAL_INTEGER;
+  type.bit_width = static_cast<int8_t>(bits);
+  type.is_signed = is_signed;
+  return type;
+}
+
+static auto column_type(Type const type, std::string_view const format)
+    -> ColumnType {
+  ColumnType result;
+  switch (type) {
+  case Type::BOOL:
+    result.physical = pq::BOOLEAN;
+    return result;
+  case Type::FLOAT32:
+    result.physical = pq::FLOAT;
+    return result;
+  case Type::FLOAT64:
+    result.physical = pq::DOUBLE;
+    return result;
+  case Type::INT8:
+    return integer_type(8, true);
+  case Type::INT16:
+    return integer_type(16, true);
+  case Type::INT32:
+    return integer_type(32, true);
+  case Type::INT64:
+    return integer_type(64, true);
+  case Type::UINT8:
+    return integer_type(8, false);
+  case Type::UINT16:
+    return integer_type(16, false);
+  case Type::UINT32:
+    return integer_type(32, false);
+  case Type::UINT64:
+    return integer_type(64, false);
+  case Type::DATE32:
+    result.physical = pq::INT32;
+    result.converted = pq::DATE;
+    result.logical = pq::LOGICAL_DATE;
+    return result;
+  case Type::TIMESTAMP: {
+    auto const unit = time_unit_of(format);
+    if (unit == TimeUnit::SECOND) {
+      throw std::invalid_argument("ParquetWriter: no second timestamps");
+    }
+    result.physical = pq::INT64;
+    result.logical = pq::LOGICAL_TIMESTAMP;
+    result.unit = unit == TimeUnit::MILLI   ? 1
+                  : unit == TimeUnit::MICRO ? 2
+                                            : 3;
+    // a timezone means instants, which is what the converted types denote
+    result.utc = format.size() > 4;
+    if (result.utc && unit != TimeUnit::NANO) {
+      result.converted = unit == TimeUnit::MILLI ? pq::TIMESTAMP_MILLIS
+                                                 : pq::TIMESTAMP_MICROS;
+    }
+    return result;
+  }
+  case Type::DECIMAL128: {
+    auto const params = parse_decimal_format(format);
+    result.physical = pq::FIXED_LEN_BYTE_ARRAY;
+    result.type_length = 16;
+    result.converted = pq::DECIMAL;
+    result.logical = pq::LOGICAL_DECIMAL;
+    result.scale = params.scale;
+    result.precision = params.precision;
+    return result;
+  }
+  default:
+    throw std::invalid_argument("ParquetWriter: unsupported column format " +
+                                std::string(format));
+  }
+}
+
+static void write_schema_element(ThriftWriter &out, std::string_view name,
+                                 ColumnType const &type) {
+  out.begin_element();
+  out.i32(1, type.physical);
+  if (type.type_length != 0) {
+    out.i32(2, type.type_length);
+  }
+  out.i32(3, pq::REQUIRED);
+  out.binary(4, name);
+  if (type.converted != pq::NO_CONVERTED_TYPE) {
+    out.i32(6, type.converted);
+  }
+  if (type.converted == pq::DECIMAL) {
+    out.i32(7, type.scale);
+    out.i32(8, type.precision);
+  }
+  if (type.logical != pq::NO_LOGICAL_TYPE) {
+    out.begin_struct(10);
+    out.begin_struct(type.logical);
+    if (type.logical == pq::LOGICAL_INTEGER) {
+      out.byte(1, type.bit_width);
+      out.boolean(2, type.is_signed);
+    } else if (type.logical == pq::LOGICAL_DECIMAL) {
+      out.i32(1, type.scale);
+      out.i32(2, type.precision);
+    } else if (type.logical == pq::LOGICAL_TIMESTAMP) {
+      out.boolean(1, type.utc);
+      out.begin_struct(2);
+      out.begin_struct(type.unit);
+      out.end_struct();
+      out.end_struct();
+    }
+    out.end_struct();
+    out.end_struct();
+  }
+  out.end_struct();
+}
+
+/**
+ * @brief the PLAIN representation of one value
+ */
+template <class T> static auto to_physical(T const value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return static_cast<uint8_t>(value);
+  } else if constexpr (std::is_same_v<T, Date32> ||
+                       std::is_same_v<T, Timestamp>) {
+    return value.value;
+  } else if constexpr (std::is_same_v<T, Decimal128>) {
+    // FIXED_LEN_BYTE_ARRAY decimals are big-endian two's complement
+    std::array<uint8_t, 16> bytes{};
+    auto const high = static_cast<uint64_t>(value.high);
+    for (size_t i = 0; i < 8; ++i) {
+      bytes[i] = static_cast<uint8_t>(high >> (56 - 8 * i));
+      bytes[8 + i] = static_cast<uint8_t>(value.low >> (56 - 8 * i));
+    }
+    return bytes;
+  } else if constexpr (std::is_integral_v<T> && sizeof(T) <= 4) {
+    // unsigned values keep their bit pattern
+    return static_cast<int32_t>(value);
+  } else if constexpr (std::is_integral_v<T>) {
+    return static_cast<int64_t>(value);
+  } else {
+    return value;
+  }
+}
+
+template <class T> static void append_plain(std::string &out, T const value) {
+  auto const physical = to_physical(value);
+  out.append(reinterpret_cast<const char *>(&physical), // NOLINT
+             sizeof(physical));
+}
+
+// little-endian bit packing, LSB first
+class BitWriter {
+public:
+  explicit BitWriter(std::string &out) : out_(out) {}
+  void put(uint64_t const value, int const width) {
+    bits_ |= value << count_;
+    count_ += width;
+    for (; count_ >= 8; count_ -= 8) {
+      out_.push_back(static_cast<char>(bits_));
+      bits_ >>= 8;
+    }
+  }
+  void flush() {
+    if (count_ > 0) {
+      out_.push_back(static_cast<char>(bits_));
+    }
+    bits_ = 0;
+    count_ = 0;
+  }
+
+private:
+  std::string &out_;
+  uint64_t bits_ = 0;
+  int count_ = 0;
+};
+
+static void put_varint(std::string &out, uint64_t v) {
+  for (; v >= 0x80; v >>= 7) {
+    out.push_back(static_cast<char>(v | 0x80));
+  }
+  out.push_back(static_cast<char>(v));
+}
+
+/**
+ * @brief RLE/bit-packed hybrid, repeats of 8 or more become RLE runs
+ * Bit-packed runs hold whole groups of 8 values, only the last one is padded.
+ */
+static void rle_hybrid(std::string &out, uint32_t const *values,
+                       size_t const n, int const bit_width) {
+  auto const pack = [&](size_t begin, size_t const end) {
+    // at most 63 groups per run keeps the header in one byte
+    constexpr size_t max_run = 63 * 8;
+    while (begin < end) {
+      auto const count = std::min(end - begin, max_run);
+      auto const groups = (count + 7) / 8;
+      put_varint(out, groups << 1 | 1);
+      BitWriter bits(out);
+      for (size_t i = 0; i < groups * 8; ++i) {
+        bits.put(i < count ? values[begin + i] : 0, bit_width);
+      }
+      bits.flush();
+      begin += count;
+    }
+  };
+
+  size_t packed_from = 0;
+  size_t i = 0;
+  while (i < n) {
+    size_t run = 1;
+    while (i + run < n && values[i + run] == values[i]) {
+      ++run;
+    }
+    // the pending bit-packed values must fill whole groups first
+    auto const fill = (8 - (i - packed_from) % 8) % 8;
+    if (run >= fill + 8) {
+      pack(packed_from, i + fill);
+      i += fill;
+      run -= fill;
+      put_varint(out, run << 1);
+      for (int byte = 0; byte < (bit_width + 7) / 8; ++byte) {
+        out.push_back(static_cast<char>(values[i] >> (8 * byte)));
+      }
+      packed_from = i + run;
+    }
+    i += run;
+  }
+  pack(packed_from, n);
+}
+
+/**
+ * @brief LZ4 block format, greedy single-probe matching
+ */
+static void lz4_compress(std::string &out, const char *src, size_t const n) {
+  constexpr int hash_log = 12;
+  // positions + 1, 0 marks an empty slot
+  std::vector<uint32_t> table(size_t{1} << hash_log, 0);
+  auto const read32 = [&](size_t const pos) {
+    uint32_t v = 0;
+    std::memcpy(&v, src + pos, sizeof(v));
+    return v;
+  };
+  auto const put_length = [&](size_t length) {
+    for (; length >= 255; length -= 255) {
+      out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+  };
+  size_t anchor = 0;
+  auto const sequence = [&](size_t const literal_end, size_t const offset,
+                            size_t const match) {
+    auto const literals = literal_end - anchor;
+    auto const extra = match == 0 ? 0 : match - 4;
+    out.push_back(static_cast<char>(std::min<size_t>(literals, 15) << 4 |
+                                    std::min<size_t>(extra, 15)));
+    if (literals >= 15) {
+      put_length(literals - 15);
+    }
+    out.append(src + anchor, literals);
+    if (match != 0) {
+      out.push_back(static_cast<char>(offset));
+      out.push_back(static_cast<char>(offset >> 8));
+      if (extra >= 15) {
+        put_length(extra - 15);
+      }
+    }
+  };
+
+  // the last match starts 12 bytes and ends 5 bytes before the end
+  for (size_t pos = 0; n >= 12 && pos <= n - 12;) {
+    auto const hash = (read32(pos) * 2654435761U) >> (32 - hash_log);
+    auto const candidate = table[hash];
+    table[hash] = static_cast<uint32_t>(pos + 1);
+    if (candidate == 0 || pos - (candidate - 1) > 65535 ||
+        read32(candidate - 1) != read32(pos)) {
+      ++pos;
+      continue;
+    }
+    auto const ref = candidate - 1;
+    size_t length = 4;
+    while (pos + length < n - 5 && src[ref + length] == src[pos + length]) {
+      ++length;
+    }
+    sequence(pos, pos - ref, length);
+    pos += length;
+    anchor = pos;
+  }
+  sequence(n, 0, 0);
+}
+
+static auto codec_id(ParquetCompression const compression) -> int32_t {
+  switch (compression) {
+  case ParquetCompression::NONE:
+    return 0;
+  case ParquetCompression::ZSTD:
+    return 6;
+  case ParquetCompression::LZ4_RAW:
+    return 7;
+  default:
+    throw std::invalid_argument("ParquetWriter: unknown compression");
+  }
+}
+
+static void compress(std::string &out, ParquetCompression const compression,
+                     std::string const &body) {
+  switch (compression) {
+  case ParquetCompression::NONE:
+    out += body;
+    return;
+  case ParquetCompression::LZ4_RAW:
+    lz4_compress(out, body.data(), body.size());
+    return;
+  case ParquetCompression::ZSTD: {
+#ifdef XARROW_WITH_ZSTD
+    auto const old_size = out.size();
+    auto const bound = ZSTD_compressBound(body.size());
+    out.resize(old_size + bound);
+    auto const size =
+        ZSTD_compress(out.data() + old_size, bound, body.data(), body.size(),
+                      ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(size) != 0) {
+      throw std::runtime_error(ZSTD_getErrorName(size));
+    }
+    out.resize(old_size + size);
+    return;
+#else
+    throw std::invalid_argument("ParquetWriter: built without zstd");
+#endif
+  }
+  default:
+    throw std::invalid_argument("ParquetWriter: unknown compression");
+  }
+}
+
+static auto page_size(size_t const size) -> int32_t {
+  if (size > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+    throw std::length_error("ParquetWriter: page too large");
+  }
+  return static_cast<int32_t>(size);
+}
+
+// PLAIN encoded min and max
+struct EncodedStats {
+  std::string min;
+  std::string max;
+};
+
+template <class T> struct MinMax {
+  T min{};
+  T max{};
+  bool valid = false;
+
+  void add(T const value) {
+    if constexpr (std::is_floating_point_v<T>) {
+      if (std::isnan(value)) {
+        return;
+      }
+    }
+    if (!valid) {
+      min = max = value;
+      valid = true;
+      return;
+    }
+    min = value < min ? value : min;
+    max = max < value ? value : max;
+  }
+  void merge(MinMax const &other) {
+    if (other.valid) {
+      add(other.min);
+      add(other.max);
+    }
+  }
+  [[nodiscard]] auto encode() const -> std::optional<EncodedStats> {
+    if (!valid) {
+      return std::nullopt;
+    }
+    EncodedStats stats;
+    auto low = min;
+    auto high = max;
+    if constexpr (std::is_floating_point_v<T>) {
+      // readers expect a zero bound to cover both signs
+      low = low == 0 ? -T{0} : low;
+      high = high == 0 ? T{0} : high;
+    }
+    append_plain(stats.min, low);
+    append_plain(stats.max, high);
+    return stats;
+  }
+};
+
+static void write_statistics(ThriftWriter &out, int16_t const id,
+                             std::optional<EncodedStats> const &stats) {
+  out.begin_struct(id);
+  out.i64(3, 0);
+  if (stats) {
+    out.binary(5, stats->max);
+    out.binary(6, stats->min);
+  }
+  out.end_struct();
+}
+
+struct EncodedChunk {
+  // pages, each a header followed by the compressed body
+  std::string bytes;
+  int64_t uncompressed = 0;
+  int64_t num_values = 0;
+  bool dictionary = false;
+  // relative to the start of the chunk
+  int64_t data_page_offset = 0;
+  std::optional<EncodedStats> stats;
+};
+
+static void write_page(EncodedChunk &chunk, ParquetCompression const codec,
+                       std::string const &body, size_t const num_values,
+                       int32_t const encoding,
+                       std::optional<EncodedStats> const *stats) {
+  std::string compressed;
+  compress(compressed, codec, body);
+  std::string header;
+  ThriftWriter out(header);
+  out.i32(1, stats == nullptr ? pq::DICTIONARY_PAGE : pq::DATA_PAGE);
+  out.i32(2, page_size(body.size()));
+  out.i32(3, page_size(compressed.size()));
+  if (stats == nullptr) {
+    out.begin_struct(7);
+    out.i32(1, page_size(num_values));
+    out.i32(2, pq::PLAIN);
+    out.end_struct();
+  } else {
+    out.begin_struct(5);
+    out.i32(1, page_size(num_values));
+    out.i32(2, encoding);
+    out.i32(3, pq::RLE);
+    out.i32(4, pq::RLE);
+    write_statistics(out, 5, *stats);
+    out.end_struct();
+  }
+  out.finish();
+  chunk.bytes += header;
+  chunk.bytes += compressed;
+  chunk.uncompressed += static_cast<int64_t>(header.size() + body.size());
+}
+
+using DictionaryKey = std::array<uint64_t, 2>;
+struct DictionaryKeyHash {
+  auto operator()(DictionaryKey const &key) const noexcept -> size_t {
+    return mix64(key[0] ^ mix64(key[1]));
+  }
+};
+
+/**
+ * @brief the open column chunk of one column, encoded as rows arrive
+ */
+class ChunkBuilder {
+public:
+  ChunkBuilder() = default;
+  virtual ~ChunkBuilder() = default;
+  ChunkBuilder(ChunkBuilder const &) = delete;
+  auto operator=(ChunkBuilder const &) -> ChunkBuilder & = delete;
+  ChunkBuilder(ChunkBuilder &&) = delete;
+  auto operator=(ChunkBuilder &&) -> ChunkBuilder & = delete;
+
+  virtual void append(ColumnHandle const &column, size_t offset,
+                      size_t rows) = 0;
+  // hands out the chunk, the builder starts the next one empty
+  virtual auto finish() -> EncodedChunk = 0;
+};
+
+/**
+ * @brief rows become dictionary indices while the distinct values fit the
+ * options, and PLAIN pages otherwise
+ * Falling back replays the indices through the dictionary, so the rows
+ * themselves are never kept. Whether a complete dictionary pays for itself
+ * is decided by finish().
+ */
+template <class T> class TypedChunkBuilder final : public ChunkBuilder {
+public:
+  explicit TypedChunkBuilder(ParquetOptions const &options)
+      : options_(options),
+        page_rows_(std::max<size_t>(1, is_bool ? options.page_bytes * 8
+                                               : options.page_bytes /
+                                                     value_size)) {
+    reset();
+  }
+
+  void append(ColumnHandle const &column, size_t const offset,
+              size_t const rows) override {
+    auto const *values = column.values<T>() + offset;
+    size_t i = 0;
+    if (indexing_) {
+      for (; i < rows && index(values[i]); ++i) {
+      }
+      if (i < rows) {
+        to_plain();
+      }
+    }
+    for (; i < rows; ++i) {
+      plain(values[i]);
+    }
+    rows_ += rows;
+  }
+
+  auto finish() -> EncodedChunk override {
+    if (indexing_ && !dictionary_.empty()) {
+      auto const size = dictionary_.size();
+      auto const bit_width = size <= 1 ? 1 : 64 - __builtin_clzll(size - 1);
+      // keep PLAIN unless the dictionary pays for itself
+      auto const encoded =
+          size * value_size + rows_ * static_cast<size_t>(bit_width) / 8;
+      if (encoded >= rows_ * value_size) {
+        to_plain();
+      } else {
+        write_dictionary(bit_width);
+      }
+    }
+    flush_page();
+    chunk_.num_values = static_cast<int64_t>(rows_);
+    chunk_.stats = total_.encode();
+    auto chunk = std::move(chunk_);
+    reset();
+    return chunk;
+  }
+
+private:
+  static constexpr size_t value_size = sizeof(to_physical(T{}));
+  static constexpr bool is_bool = std::is_same_v<T, bool>;
+
+  void reset() {
+    indexing_ = options_.dictionary && !is_bool;
+    lookup_.clear();
+    dictionary_.clear();
+    indices_.clear();
+    chunk_ = {};
+    total_ = {};
+    page_ = {};
+    body_.clear();
+    page_count_ = 0;
+    rows_ = 0;
+  }
+
+  // false once the value would exceed the dictionary's entries
+  auto index(T const value) -> bool {
+    auto const physical = to_physical(value);
+    DictionaryKey key{};
+    std::memcpy(key.data(), &physical, sizeof(physical));
+    auto const [it, inserted] =
+        lookup_.try_emplace(key, static_cast<uint32_t>(dictionary_.size()));
+    if (inserted) {
+      if (dictionary_.size() == options_.dictionary_max_entries) {
+        lookup_.erase(it);
+        return false;
+      }
+      dictionary_.push_back(value);
+    }
+    indices_.push_back(it->second);
+    return true;
+  }
+
+  void to_plain() {
+    indexing_ = false;
+    for (auto const index : indices_) {
+      plain(dictionary_[index]);
+    }
+    decltype(lookup_)().swap(lookup_);
+    std::vector<T>().swap(dictionary_);
+    std::vector<uint32_t>().swap(indices_);
+  }
+
+  void plain(T const value) {
+    if constexpr (is_bool) {
+      bits_.put(value ? 1 : 0, 1);
+    } else {
+      append_plain(body_, value);
+    }
+    page_.add(value);
+    if (++page_count_ == page_rows_) {
+      flush_page();
+    }
+  }
+
+  void flush_page() {
+    if (page_count_ == 0) {
+      return;
+    }
+    bits_.flush();
+    total_.merge(page_);
+    auto const stats = page_.encode();
+    write_page(chunk_, options_.compression, body_, page_count_, pq::PLAIN,
+               &stats);
+    body_.clear();
+    page_ = {};
+    page_count_ = 0;
+  }
+
+  void write_dictionary(int const bit_width) {
+    chunk_.dictionary = true;
+    for (auto const &value : dictionary_) {
+      append_plain(body_, value);
+    }
+    write_page(chunk_, options_.compression, body_, dictionary_.size(),
+               pq::PLAIN, nullptr);
+    chunk_.data_page_offset = static_cast<int64_t>(chunk_.bytes.size());
+    for (size_t begin = 0; begin < rows_; begin += page_rows_) {
+      auto const end = std::min(rows_, begin + page_rows_);
+      body_.clear();
+      body_.push_back(static_cast<char>(bit_width));
+      rle_hybrid(body_, indices_.data() + begin, end - begin, bit_width);
+      MinMax<T> stats;
+      for (size_t i = begin; i < end; ++i) {
+        stats.add(dictionary_[indices_[i]]);
+      }
+      total_.merge(stats);
+      auto const encoded = stats.encode();
+      write_page(chunk_, options_.compression, body_, end - begin,
+                 pq::RLE_DICTIONARY, &encoded);
+    }
+    body_.clear();
+  }
+
+  ParquetOptions const &options_;
+  size_t const page_rows_;
+  // still collecting a dictionary
+  bool indexing_ = false;
+  std::unordered_map<DictionaryKey, uint32_t, DictionaryKeyHash> lookup_;
+  std::vector<T> dictionary_;
+  std::vector<uint32_t> indices_;
+  EncodedChunk chunk_;
+  MinMax<T> total_;
+  // the PLAIN page being filled
+  MinMax<T> page_;
+  std::string body_;
+  BitWriter bits_{body_};
+  size_t page_count_ = 0;
+  size_t rows_ = 0;
+};
+
+template <class T> struct ChunkBuilderFactory {
+  static auto run(ColumnHandle const & /*column*/,
+                  ParquetOptions const &options)
+      -> std::unique_ptr<ChunkBuilder> {
+    if constexpr (parquet_supported_v<T>) {
+      return std::make_unique<TypedChunkBuilder<T>>(options);
+    } else {
+      throw std::invalid_argument("ParquetWriter: unsupported column type");
+    }
+  }
+};
+
+/**
+ * @brief run task(i) for every column, spread over up to threads workers
+ */
+template <class Task>
+static void for_each_column(size_t const columns, size_t const threads,
+                            Task const &task) {
+  std::atomic<size_t> next{0};
+  std::mutex mutex;
+  std::exception_ptr error;
+  auto const worker = [&]() {
+    for (size_t i = next++; i < columns; i = next++) {
+      try {
+        task(i);
+      } catch (...) {
+        std::lock_guard lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  for (size_t t = 1; t < std::min(columns, threads); ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+static void write_all(int const fd, const char *data, size_t size) {
+  while (size > 0) {
+    auto const written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "write");
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+struct SchemaColumn {
+  std::string name;
+  std::string format;
+  Type type;
+  ColumnType parquet;
+};
+
+struct ChunkMeta {
+  int64_t offset;
+  int64_t data_page_offset;
+  bool dictionary;
+  int64_t num_values;
+  int64_t uncompressed;
+  int64_t compressed;
+  std::optional<EncodedStats> stats;
+};
+
+struct RowGroupMeta {
+  std::vector<ChunkMeta> chunks;
+  int64_t num_rows;
+};
+
+constexpr std::string_view parquet_magic = "PAR1";
+// write() batches shorter than this are encoded on the calling thread
+constexpr size_t parallel_rows = size_t{1} << 14;
+} // namespace detail
+
+struct ParquetWriter::State {
+  int fd = -1;
+  ParquetOptions options;
+  bool open = true;
+  bool has_schema = false;
+  uint64_t offset = 0;
+  int64_t rows = 0;
+  std::vector<detail::SchemaColumn> schema;
+  std::vector<detail::RowGroupMeta> row_groups;
+  // the open row group, one chunk per column, carried across write() calls
+  std::vector<std::unique_ptr<detail::ChunkBuilder>> builders;
+  size_t open_rows = 0;
+
+  void write(std::string_view const bytes) {
+    detail::write_all(fd, bytes.data(), bytes.size());
+    offset += bytes.size();
+  }
+
+  [[nodiscard]] auto threads() const -> size_t {
+    return options.threads != 0
+               ? options.threads
+               : std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  /**
+   * @brief encode rows into the open row group, writing it once it is full
+   */
+  void append(std::vector<ColumnHandle> const &columns, size_t const first,
+              size_t const n) {
+    auto const full = open_rows + n == options.row_group_rows;
+    std::vector<detail::EncodedChunk> chunks(full ? builders.size() : 0);
+    // short batches are not worth a thread each
+    auto const workers =
+        full || n >= detail::parallel_rows ? threads() : size_t{1};
+    try {
+      detail::for_each_column(builders.size(), workers, [&](size_t const i) {
+        builders[i]->append(columns[i], first, n);
+        if (full) {
+          chunks[i] = builders[i]->finish();
+        }
+      });
+    } catch (...) {
+      // some chunks already hold the rows, they cannot be taken back
+      open = false;
+      throw;
+    }
+    open_rows += n;
+    if (full) {
+      write_group(chunks);
+    }
+  }
+
+  void flush() {
+    if (open_rows == 0) {
+      return;
+    }
+    std::vector<detail::EncodedChunk> chunks(builders.size());
+    try {
+      detail::for_each_column(builders.size(), threads(),
+                              [&](size_t const i) {
+                                chunks[i] = builders[i]->finish();
+                              });
+    } catch (...) {
+      open = false;
+      throw;
+    }
+    write_group(chunks);
+  }
+
+  void write_group(std::vector<detail::EncodedChunk> const &chunks) {
+    detail::RowGroupMeta group{{}, static_cast<int64_t>(open_rows)};
+    try {
+      for (auto const &chunk : chunks) {
+        auto const start = static_cast<int64_t>(offset);
+        write(chunk.bytes);
+        group.chunks.push_back({start, start + chunk.data_page_offset,
+                                chunk.dictionary, chunk.num_values,
+                                chunk.uncompressed,
+                                static_cast<int64_t>(chunk.bytes.size()),
+                                chunk.stats});
+      }
+    } catch (...) {
+      // a torn row group cannot be described by a footer
+      open = false;
+      throw;
+    }
+    row_groups.push_back(std::move(group));
+    rows += static_cast<int64_t>(open_rows);
+    open_rows = 0;
+  }
+};
+
+ParquetWriter::ParquetWriter(int const fd, ParquetOptions const &options)
+    : state_(std::make_unique<State>()) {
+  state_->fd = fd;
+  state_->options = options;
+  if (options.row_group_rows == 0 || options.page_bytes == 0) {
+    throw std::invalid_argument("ParquetWriter: empty row groups or pages");
+  }
+#ifndef XARROW_WITH_ZSTD
+  if (options.compression == ParquetCompression::ZSTD) {
+    throw std::invalid_argument("ParquetWriter: built without zstd");
+  }
+#endif
+  detail::codec_id(options.compression);
+  state_->write(detail::parquet_magic);
+}
+
+ParquetWriter::~ParquetWriter() noexcept {
+  try {
+    close();
+  } catch (...) {
+    // destructors must not throw, call close() to see the error
+  }
+}
+
+auto ParquetWriter::rows_written() const noexcept -> int64_t {
+  return state_->rows + static_cast<int64_t>(state_->open_rows);
+}
+auto ParquetWriter::bytes_written() const noexcept -> uint64_t {
+  return state_->offset;
+}
+
+void ParquetWriter::write(std::vector<ColumnHandle> const &columns) {
+  auto &state = *state_;
+  if (!state.open) {
+    throw std::runtime_error("ParquetWriter: already closed");
+  }
+  // the first batch fixes the schema once it passes every check
+  std::vector<detail::SchemaColumn> first;
+  if (!state.has_schema) {
+    for (auto const &column : columns) {
+      first.push_back({std::string(column.name), std::string(column.format),
+                       column.type,
+                       detail::column_type(column.type, column.format)});
+    }
+  }
+  auto const &schema = state.has_schema ? state.schema : first;
+  if (columns.size() != schema.size()) {
+    throw std::invalid_argument("ParquetWriter: column count differs");
+  }
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (columns[i].name != schema[i].name ||
+        columns[i].format != schema[i].format) {
+      throw std::invalid_argument("ParquetWriter: schema differs");
+    }
+    if (columns[i].length != columns[0].length) {
+      throw std::invalid_argument("ParquetWriter: column lengths differ");
+    }
+  }
+  if (!state.has_schema) {
+    std::vector<std::unique_ptr<detail::ChunkBuilder>> builders;
+    for (auto const &column : columns) {
+      builders.push_back(
+          dispatch<detail::ChunkBuilderFactory>(column, state.options));
+    }
+    state.schema = std::move(first);
+    state.builders = std::move(builders);
+    state.has_schema = true;
+  }
+
+  auto const rows = columns.empty() ? 0 : columns[0].length;
+  // rows top up the open row group, full groups are written on the way
+  for (size_t offset = 0; offset < rows;) {
+    auto const n =
+        std::min(rows - offset, state.options.row_group_rows - state.open_rows);
+    state.append(columns, offset, n);
+    offset += n;
+  }
+}
+
+void ParquetWriter::close() {
+  auto &state = *state_;
+  if (!state.open) {
+    return;
+  }
+  state.open = false;
+  state.flush();
+
+  using detail::ThriftWriter;
+  std::string footer;
+  ThriftWriter out(footer);
+  out.i32(1, 1);
+  out.begin_list(2, ThriftWriter::STRUCT, state.schema.size() + 1);
+  out.begin_element();
+  out.binary(4, "schema");
+  out.i32(5, static_cast<int32_t>(state.schema.size()));
+  out.end_struct();
+  for (auto const &column : state.schema) {
+    detail::write_schema_element(out, column.name, column.parquet);
+  }
+  out.i64(3, state.rows);
+
+  out.begin_list(4, ThriftWriter::STRUCT, state.row_groups.size());
+  for (auto const &group : state.row_groups) {
+    out.begin_element();
+    out.begin_list(1, ThriftWriter::STRUCT, group.chunks.size());
+    int64_t uncompressed = 0;
+    int64_t compressed = 0;
+    for (size_t i = 0; i < group.chunks.size(); ++i) {
+      auto const &chunk = group.chunks[i];
+      uncompressed += chunk.uncompressed;
+      compressed += chunk.compressed;
+      out.begin_element();
+      out.i64(2, chunk.offset);
+      out.begin_struct(3);
+      out.i32(1, state.schema[i].parquet.physical);
+      if (chunk.dictionary) {
+        out.begin_list(2, ThriftWriter::I32, 3);
+        out.element_i32(detail::pq::PLAIN);
+        out.element_i32(detail::pq::RLE);
+        out.element_i32(detail::pq::RLE_DICTIONARY);
+      } else {
+        out.begin_list(2, ThriftWriter::I32, 2);
+        out.element_i32(detail::pq::PLAIN);
+        out.element_i32(detail::pq::RLE);
+      }
+      out.begin_list(3, ThriftWriter::BINARY, 1);
+      out.element_binary(state.schema[i].name);
+      out.i32(4, detail::codec_id(state.options.compression));
+      out.i64(5, chunk.num_values);
+      out.i64(6, chunk.uncompressed);
+      out.i64(7, chunk.compressed);
+      out.i64(9, chunk.data_page_offset);
+      if (chunk.dictionary) {
+        out.i64(11, chunk.offset);
+      }
+      detail::write_statistics(out, 12, chunk.stats);
+      out.end_struct();
+      out.end_struct();
+    }
+    out.i64(2, uncompressed);
+    out.i64(3, group.num_rows);
+    if (!group.chunks.empty()) {
+      out.i64(5, group.chunks.front().offset);
+    }
+    out.i64(6, compressed);
+    out.end_struct();
+  }
+
+  out.binary(6, "xarrow version 0.0.1");
+  // min/max statistics follow each type's natural order
+  out.begin_list(7, ThriftWriter::STRUCT, state.schema.size());
+  for (size_t i = 0; i < state.schema.size(); ++i) {
+    out.begin_element();
+    out.begin_struct(1);
+    out.end_struct();
+    out.end_struct();
+  }
+  out.finish();
+
+  auto const length = static_cast<uint32_t>(footer.size());
+  footer.append(reinterpret_cast<const char *>(&length), // NOLINT
+                sizeof(length));
+  footer += detail::parquet_magic;
+  state.write(footer);
+}
+} // namespace xarrow
@@ -0,0 +1,548 @@
+#include "shm.hpp"
+#include "column_handle.hpp"
+#include "common.hpp"
+#include <cerrno>
+#include <limits>
+#include <system_error>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace xarrow {
+namespace detail {
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<int64_t>::is_always_lock_free,
+              "shared memory counters must be address free");
+
+constexpr static uint64_t shm_magic = 0x4d53574f52524158ULL; // "XARROWSM"
+constexpr static uint32_t wire_magic = 0x58415357U;          // "XASW"
+constexpr static uint64_t no_buffer = UINT64_MAX;
+// refs while reset() runs, retain() waits for it to clear
+constexpr static int64_t resetting = std::numeric_limits<int64_t>::min();
+
+// lives at offset 0 of every arena, shared by all processes mapping it
+struct ShmHeader {
+  uint64_t magic;
+  uint64_t size;
+  std::atomic<uint64_t> used;
+  std::atomic<int64_t> refs;
+};
+constexpr static size_t header_bytes = align_round(sizeof(ShmHeader), 64);
+
+struct WireHeader {
+  uint32_t magic;
+  uint32_t n_columns;
+  uint64_t payload_bytes;
+};
+
+// followed by n_buffers offsets, then the format and name bytes
+struct WireColumn {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  uint32_t format_len;
+  uint32_t name_len;
+};
+
+static auto sys_error(const char *what) -> std::system_error {
+  return {errno, std::generic_category(), what};
+}
+
+static auto create_memfd(size_t const size) -> int {
+  auto const fd = memfd_create("xarrow", MFD_CLOEXEC);
+  if (fd < 0) {
+    throw sys_error("memfd_create");
+  }
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    auto err = sys_error("ftruncate");
+    close(fd);
+    throw err;
+  }
+  return fd;
+}
+
+static void append(std::vector<std::byte> &out, const void *src,
+                   size_t const bytes) {
+  auto const *p = static_cast<const std::byte *>(src);
+  out.insert(out.end(), p, p + bytes);
+}
+
+struct WireReader {
+  const std::byte *pos;
+  const std::byte *end;
+
+  void read(void *dst, size_t const bytes) {
+    if (static_cast<size_t>(end - pos) < bytes) [[unlikely]] {
+      throw std::runtime_error("shm_receive: malformed descriptor");
+    }
+    std::memcpy(dst, pos, bytes);
+    pos += bytes;
+  }
+  auto read_string(size_t const bytes) -> std::string {
+    std::string result(bytes, '\0');
+    read(result.data(), bytes);
+    return result;
+  }
+};
+
+// bytes taken by n values of the given width, bit packed below 8 bits
+static auto span_bytes(uint64_t const n, uint64_t const bits) -> uint64_t {
+  if (n > (UINT64_MAX - 7) / bits) [[unlikely]] {
+    throw std::runtime_error("shm_receive: malformed descriptor");
+  }
+  return (n * bits + 7) / 8;
+}
+
+// resolves a flat column's buffers, each must fit inside the mapping
+static auto map_buffers(ShmArena const &arena, WireColumn const &wire,
+                        std::string const &format,
+                        std::vector<uint64_t> const &offsets)
+    -> std::vector<const void *> {
+  if (wire.length < 0 || wire.offset < 0 ||
+      wire.length > std::numeric_limits<int64_t>::max() - wire.offset)
+      [[unlikely]] {
+    throw std::runtime_error("shm_receive: malformed descriptor");
+  }
+  auto const values = static_cast<uint64_t>(wire.offset + wire.length);
+  // variable width formats carry an offsets buffer, then the bytes
+  uint64_t offset_bits = 0;
+  if (format == "u" || format == "z") {
+    offset_bits = 32;
+  } else if (format == "U" || format == "Z") {
+    offset_bits = 64;
+  }
+  if (offsets.size() != (offset_bits != 0 ? 3U : 2U)) [[unlikely]] {
+    throw std::runtime_error("shm_receive: malformed descriptor");
+  }
+  std::vector<const void *> buffers(offsets.size(), nullptr);
+  auto const map = [&](size_t const i, uint64_t const bytes) {
+    if (offsets[i] != no_buffer) {
+      buffers[i] = arena.at(offsets[i], bytes);
+    }
+  };
+  map(0, span_bytes(values, 1));
+  if (offset_bits == 0) {
+    auto const type = format2type_enum(format.c_str());
+    map(1, span_bytes(values, type == Type::BOOL ? 1 : 8 * type_size(type)));
+    return buffers;
+  }
+  map(1, span_bytes(values + 1, offset_bits));
+  int64_t end = 0;
+  if (buffers[1] != nullptr) {
+    auto const *last = static_cast<const std::byte *>(buffers[1]) +
+                       values * (offset_bits / 8);
+    if (offset_bits == 32) {
+      int32_t narrow = 0;
+      std::memcpy(&narrow, last, sizeof(narrow));
+      end = narrow;
+    } else {
+      std::memcpy(&end, last, sizeof(end));
+    }
+  }
+  if (end < 0) [[unlikely]] {
+    throw std::runtime_error("shm_receive: malformed descriptor");
+  }
+  map(2, static_cast<uint64_t>(end));
+  return buffers;
+}
+
+static void recv_all(int const socket, void *dst, size_t const bytes) {
+  auto *p = static_cast<std::byte *>(dst);
+  size_t done = 0;
+  while (done < bytes) {
+    auto const n = recv(socket, p + done, bytes - done, MSG_WAITALL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n == 0) {
+      throw std::runtime_error("shm_receive: peer closed");
+    }
+    if (n < 0) {
+      throw sys_error("recv");
+    }
+    done += static_cast<size_t>(n);
+  }
+}
+
+// the sender's reference on the arena, handed back by the last array
+// using the mapping, in whichever process the sender lives
+struct ShmBatchPin {
+  explicit ShmBatchPin(std::shared_ptr<ShmArena> mapped)
+      : arena(std::move(mapped)) {}
+  ShmBatchPin(const ShmBatchPin &) = delete;
+  auto operator=(const ShmBatchPin &) -> ShmBatchPin & = delete;
+  ShmBatchPin(ShmBatchPin &&) = delete;
+  auto operator=(ShmBatchPin &&) -> ShmBatchPin & = delete;
+  ~ShmBatchPin() { arena->release(); }
+
+  std::shared_ptr<ShmArena> arena;
+};
+
+// each child pins the mapping itself, so it may be moved out of the batch
+struct ShmChildHolder {
+  std::shared_ptr<ShmBatchPin> pin;
+  std::vector<const void *> buffers;
+};
+
+// releases whichever children the consumer did not move out
+template <class Arrow> struct ShmChildren {
+  ShmChildren() = default;
+  ShmChildren(const ShmChildren &) = delete;
+  auto operator=(const ShmChildren &) -> ShmChildren & = delete;
+  ShmChildren(ShmChildren &&) = delete;
+  auto operator=(ShmChildren &&) -> ShmChildren & = delete;
+  ~ShmChildren() {
+    for (auto &child : children) {
+      if (child.release != nullptr) {
+        child.release(&child);
+      }
+    }
+  }
+
+  std::vector<Arrow> children;
+  std::vector<Arrow *> child_ptrs;
+};
+
+struct ShmArrayHolder : ShmChildren<ArrowArray> {
+  std::shared_ptr<ShmBatchPin> pin;
+  std::array<const void *, 1> top_buffers{nullptr};
+};
+using ShmSchemaHolder = ShmChildren<ArrowSchema>;
+} // namespace detail
+
+ShmArena::ShmArena(size_t const capacity)
+    : ShmArena(detail::create_memfd(detail::header_bytes + capacity),
+               detail::header_bytes + capacity) {
+  auto *h = new (base_) detail::ShmHeader();
+  h->magic = detail::shm_magic;
+  h->size = size_;
+  h->used.store(detail::header_bytes, std::memory_order_relaxed);
+  h->refs.store(0, std::memory_order_release);
+}
+
+ShmArena::ShmArena(int const fd, size_t const size)
+    : fd_(fd), size_(size), base_(nullptr) {
+  auto *p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (p == MAP_FAILED) {
+    auto err = detail::sys_error("mmap");
+    close(fd_);
+    throw err;
+  }
+  base_ = static_cast<std::byte *>(p);
+}
+
+auto ShmArena::attach(int const fd) -> std::shared_ptr<ShmArena> {
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    auto err = detail::sys_error("fstat");
+    close(fd);
+    throw err;
+  }
+  auto const size = static_cast<size_t>(st.st_size);
+  if (size < detail::header_bytes) {
+    close(fd);
+    throw std::runtime_error("ShmArena::attach: not an xarrow arena");
+  }
+  auto arena = std::shared_ptr<ShmArena>(new ShmArena(fd, size));
+  if (arena->header()->magic != detail::shm_magic ||
+      arena->header()->size != size) {
+    throw std::runtime_error("ShmArena::attach: not an xarrow arena");
+  }
+  return arena;
+}
+
+ShmArena::~ShmArena() noexcept {
+  munmap(base_, size_);
+  close(fd_);
+}
+
+auto ShmArena::header() const noexcept -> detail::ShmHeader * {
+  return reinterpret_cast<detail::ShmHeader *>(base_); // NOLINT
+}
+
+auto ShmArena::allocate(size_t const alignment, size_t const size) noexcept
+    -> void * {
+  auto &used = header()->used;
+  auto cur = used.load(std::memory_order_relaxed);
+  size_t begin = 0;
+  do {
+    begin = align_round(cur, alignment);
+    if (begin > size_ || size > size_ - begin) {
+      return nullptr;
+    }
+  } while (!used.compare_exchange_weak(cur, begin + size,
+                                       std::memory_order_relaxed));
+  return base_ + begin;
+}
+
+auto ShmArena::used() const noexcept -> size_t {
+  return header()->used.load(std::memory_order_relaxed) - detail::header_bytes;
+}
+
+auto ShmArena::contains(const void *ptr) const noexcept -> bool {
+  auto const p = reinterpret_cast<uintptr_t>(ptr);      // NOLINT
+  auto const base = reinterpret_cast<uintptr_t>(base_); // NOLINT
+  return p >= base + detail::header_bytes && p < base + size_;
+}
+
+auto ShmArena::offset_of(const void *ptr) const -> uint64_t {
+  if (!contains(ptr)) [[unlikely]] {
+    throw std::out_of_range("ShmArena::offset_of: pointer outside arena");
+  }
+  return static_cast<const std::byte *>(ptr) - base_;
+}
+
+auto ShmArena::at(uint64_t const offset, uint64_t const bytes) const
+    -> void * {
+  if (offset < detail::header_bytes || offset > size_ ||
+      bytes > size_ - offset) [[unlikely]] {
+    throw std::out_of_range("ShmArena::at: offset outside arena");
+  }
+  return base_ + offset;
+}
+
+auto ShmArena::outstanding() const noexcept -> int64_t {
+  return std::max<int64_t>(header()->refs.load(std::memory_order_acquire), 0);
+}
+
+void ShmArena::retain() noexcept {
+  auto &refs = header()->refs;
+  auto cur = refs.load(std::memory_order_relaxed);
+  do {
+    // a reset in flight ends with a single store
+    while (cur < 0) {
+      std::this_thread::yield();
+      cur = refs.load(std::memory_order_relaxed);
+    }
+  } while (!refs.compare_exchange_weak(cur, cur + 1,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed));
+}
+
+void ShmArena::release() noexcept {
+  header()->refs.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ShmArena::reset() {
+  // claim refs == 0 in one step, so no send can retain mid reset
+  auto &refs = header()->refs;
+  int64_t idle = 0;
+  if (!refs.compare_exchange_strong(idle, detail::resetting,
+                                    std::memory_order_acquire)) {
+    throw std::logic_error("ShmArena::reset: arrays still outstanding");
+  }
+  header()->used.store(detail::header_bytes, std::memory_order_relaxed);
+  refs.store(0, std::memory_order_release);
+}
+
+void ShmBatchWriter::add(ArrowSchema const &schema, ArrowArray const &array) {
+  if (schema.n_children != 0 || array.n_children != 0 ||
+      schema.dictionary != nullptr || array.dictionary != nullptr) {
+    throw std::invalid_argument("ShmBatchWriter::add: only flat columns");
+  }
+  if (!columns_.empty() && columns_.front().length != array.length) {
+    throw std::invalid_argument("ShmBatchWriter::add: length mismatch");
+  }
+  Column column{schema.format,
+                schema.name != nullptr ? schema.name : "",
+                array.length,
+                array.null_count,
+                array.offset,
+                {}};
+  column.buffers.reserve(array.n_buffers);
+  for (int64_t i = 0; i < array.n_buffers; ++i) {
+    auto const *buffer = array.buffers[i];
+    if (buffer == nullptr) {
+      column.buffers.push_back(detail::no_buffer);
+    } else if (arena_.contains(buffer)) {
+      column.buffers.push_back(arena_.offset_of(buffer));
+    } else {
+      throw std::invalid_argument(
+          "ShmBatchWriter::add: buffer outside shared arena");
+    }
+  }
+  columns_.push_back(std::move(column));
+}
+
+void ShmBatchWriter::send(int const socket) const {
+  std::vector<std::byte> payload;
+  for (auto const &column : columns_) {
+    detail::WireColumn const wire{
+        column.length,
+        column.null_count,
+        column.offset,
+        static_cast<int64_t>(column.buffers.size()),
+        static_cast<uint32_t>(column.format.size()),
+        static_cast<uint32_t>(column.name.size())};
+    detail::append(payload, &wire, sizeof(wire));
+    detail::append(payload, column.buffers.data(),
+                   column.buffers.size() * sizeof(uint64_t));
+    detail::append(payload, column.format.data(), column.format.size());
+    detail::append(payload, column.name.data(), column.name.size());
+  }
+  detail::WireHeader const head{detail::wire_magic,
+                                static_cast<uint32_t>(columns_.size()),
+                                payload.size()};
+  std::vector<std::byte> message;
+  message.reserve(sizeof(head) + payload.size());
+  detail::append(message, &head, sizeof(head));
+  message.insert(message.end(), payload.begin(), payload.end());
+
+  // the fd rides along with the first byte
+  iovec iov{message.data(), message.size()};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int))> control{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+  auto *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  auto const fd = arena_.fd();
+  std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+
+  arena_.retain();
+  ssize_t n = 0;
+  do {
+    n = sendmsg(socket, &msg, MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    auto err = detail::sys_error("sendmsg");
+    arena_.release();
+    throw err;
+  }
+  // receiver owns the reference from here on, even if the tail fails
+  auto done = static_cast<size_t>(n);
+  while (done < message.size()) {
+    n = ::send(socket, message.data() + done, message.size() - done,
+               MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw detail::sys_error("send");
+    }
+    done += static_cast<size_t>(n);
+  }
+}
+
+void shm_receive(int const socket, ArrowSchema &schema, ArrowArray &array) {
+  detail::WireHeader head{};
+  iovec iov{&head, sizeof(head)};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int))> control{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+  ssize_t n = 0;
+  do {
+    n = recvmsg(socket, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    throw detail::sys_error("recvmsg");
+  }
+  int fd = -1;
+  for (auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+    }
+  }
+  if (fd < 0) {
+    throw std::runtime_error("shm_receive: no arena fd received");
+  }
+  // from here the sender's reference is ours, the pin gives it back
+  auto const pin =
+      std::make_shared<detail::ShmBatchPin>(ShmArena::attach(fd));
+  auto const &arena = *pin->arena;
+  if (static_cast<size_t>(n) < sizeof(head)) {
+    detail::recv_all(socket, reinterpret_cast<std::byte *>(&head) + n, // NOLINT
+                     sizeof(head) - static_cast<size_t>(n));
+  }
+  if (head.magic != detail::wire_magic) {
+    throw std::runtime_error("shm_receive: malformed descriptor");
+  }
+  std::vector<std::byte> payload(head.payload_bytes);
+  detail::recv_all(socket, payload.data(), payload.size());
+
+  auto const n_columns = static_cast<size_t>(head.n_columns);
+  auto schema_holder = std::make_unique<detail::ShmSchemaHolder>();
+  auto array_holder = std::make_unique<detail::ShmArrayHolder>();
+  array_holder->pin = pin;
+  // both stay put from here, children point into them
+  schema_holder->children.reserve(n_columns);
+  array_holder->children.reserve(n_columns);
+  detail::WireReader reader{payload.data(), payload.data() + payload.size()};
+  int64_t length = 0;
+  for (size_t c = 0; c < n_columns; ++c) {
+    detail::WireColumn wire{};
+    reader.read(&wire, sizeof(wire));
+    if (wire.n_buffers < 0 || wire.n_buffers > 3) {
+      throw std::runtime_error("shm_receive: malformed descriptor");
+    }
+    if (c > 0 && wire.length != length) {
+      throw std::runtime_error("shm_receive: column lengths differ");
+    }
+    length = wire.length;
+    std::vector<uint64_t> offsets(static_cast<size_t>(wire.n_buffers));
+    reader.read(offsets.data(), offsets.size() * sizeof(uint64_t));
+    auto const format = reader.read_string(wire.format_len);
+    auto const name = reader.read_string(wire.name_len);
+    auto child_holder = std::make_unique<detail::ShmChildHolder>(
+        detail::ShmChildHolder{
+            pin, detail::map_buffers(arena, wire, format, offsets)});
+
+    auto &schema_child = schema_holder->children.emplace_back();
+    detail::schema_move(schema_child, format, name);
+    schema_holder->child_ptrs.push_back(&schema_child);
+
+    auto &child = array_holder->children.emplace_back();
+    child.length = wire.length;
+    child.null_count = wire.null_count;
+    child.offset = wire.offset;
+    child.n_buffers = wire.n_buffers;
+    child.buffers = child_holder->buffers.data();
+    child.release = [](struct ArrowArray *now) {
+      delete static_cast<detail::ShmChildHolder *>(now->private_data);
+      now->release = nullptr;
+    };
+    child.private_data = child_holder.release();
+    array_holder->child_ptrs.push_back(&child);
+  }
+
+  schema.format = "+s";
+  schema.name = "";
+  schema.metadata = nullptr;
+  schema.flags = 0;
+  schema.n_children = static_cast<int64_t>(n_columns);
+  schema.children = schema_holder->child_ptrs.data();
+  schema.dictionary = nullptr;
+  schema.release = [](struct ArrowSchema *now) {
+    delete static_cast<detail::ShmSchemaHolder *>(now->private_data);
+    now->release = nullptr;
+  };
+  schema.private_data = schema_holder.release();
+
+  array.length = length;
+  array.null_count = 0;
+  array.offset = 0;
+  array.n_buffers = 1;
+  array.n_children = static_cast<int64_t>(n_columns);
+  array.buffers = array_holder->top_buffers.data();
+  array.children = array_holder->child_ptrs.data();
+  array.dictionary = nullptr;
+  array.release = [](struct ArrowArray *now) {
+    delete static_cast<detail::ShmArrayHolder *>(now->private_data);
+    now->release = nullptr;
+    metrics::on_release();
+  };
+  array.private_data = array_holder.release();
+  metrics::on_export();
+}
+} // namespace xarrow
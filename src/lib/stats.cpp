@@ -0,0 +1,105 @@
+#include "stats.hpp"
+#include "common.hpp"
+#include <cmath>
+#include <limits>
+
+namespace xarrow {
+namespace detail {
+static void put_int32(std::string &out, size_t const value) {
+  if (value > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+    throw std::length_error("metadata entry too large");
+  }
+  auto const v = static_cast<int32_t>(value);
+  out.append(reinterpret_cast<const char *>(&v), sizeof(v)); // NOLINT
+}
+
+static auto get_int32(const char *&pos) -> int32_t {
+  int32_t v = 0;
+  std::memcpy(&v, pos, sizeof(v));
+  pos += sizeof(v);
+  if (v < 0) {
+    throw std::runtime_error("Malformed schema metadata");
+  }
+  return v;
+}
+
+auto decimal128_string(Decimal128 const value) -> std::string {
+  __extension__ using uint128_t = unsigned __int128;
+  auto magnitude =
+      (static_cast<uint128_t>(static_cast<uint64_t>(value.high)) << 64) |
+      value.low;
+  bool const negative = value.high < 0;
+  if (negative) {
+    magnitude = ~magnitude + 1;
+  }
+  std::string digits;
+  do {
+    digits.push_back(static_cast<char>('0' + static_cast<int>(magnitude % 10)));
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (negative) {
+    digits.push_back('-');
+  }
+  return {digits.rbegin(), digits.rend()};
+}
+} // namespace detail
+
+auto encode_metadata(
+    std::vector<std::pair<std::string, std::string>> const &pairs)
+    -> std::string {
+  std::string out;
+  detail::put_int32(out, pairs.size());
+  for (auto const &[key, value] : pairs) {
+    detail::put_int32(out, key.size());
+    out += key;
+    detail::put_int32(out, value.size());
+    out += value;
+  }
+  return out;
+}
+
+auto decode_metadata(const char *metadata)
+    -> std::vector<std::pair<std::string, std::string>> {
+  std::vector<std::pair<std::string, std::string>> pairs;
+  if (metadata == nullptr) {
+    return pairs;
+  }
+  auto const *pos = metadata;
+  // counts and lengths come from a foreign producer, get_int32 rejects
+  // negative ones and the pairs grow as they are read instead of trusting n
+  auto const n = detail::get_int32(pos);
+  for (int32_t i = 0; i < n; ++i) {
+    auto const key_len = static_cast<size_t>(detail::get_int32(pos));
+    std::string key(pos, key_len);
+    pos += key_len;
+    auto const value_len = static_cast<size_t>(detail::get_int32(pos));
+    std::string value(pos, value_len);
+    pos += value_len;
+    pairs.emplace_back(std::move(key), std::move(value));
+  }
+  return pairs;
+}
+
+void HyperLogLog::merge(HyperLogLog const &other) noexcept {
+  for (size_t i = 0; i < registers_.size(); ++i) {
+    registers_[i] = std::max(registers_[i], other.registers_[i]);
+  }
+}
+
+auto HyperLogLog::estimate() const noexcept -> double {
+  auto const m = static_cast<double>(registers_.size());
+  double sum = 0;
+  size_t zeros = 0;
+  for (auto const reg : registers_) {
+    sum += std::ldexp(1.0, -reg);
+    zeros += reg == 0 ? 1 : 0;
+  }
+  auto const alpha = 0.7213 / (1 + 1.079 / m);
+  auto const raw = alpha * m * m / sum;
+  // linear counting is more accurate while many registers are still empty
+  if (raw <= 2.5 * m && zeros > 0) {
+    return m * std::log(m / static_cast<double>(zeros));
+  }
+  return raw;
+}
+} // namespace xarrow
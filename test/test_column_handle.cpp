@@ -0,0 +1,70 @@
+#include "doctest/doctest.h"
+#include "column_handle.hpp"
+#include <cstdint>
+#include <string>
+
+using namespace xarrow;
+
+namespace {
+template <class T> struct SumKernel {
+  static auto run(ColumnHandle const &column, double const scale) -> double {
+    if constexpr (std::is_arithmetic_v<T>) {
+      double sum = 0;
+      auto const *values = column.values<T>();
+      for (size_t i = 0; i < column.length; ++i) {
+        sum += static_cast<double>(values[i]);
+      }
+      return sum * scale;
+    } else {
+      throw std::invalid_argument("SumKernel: not a number");
+    }
+  }
+};
+static_assert(kernel_table<SumKernel>.size() == type_count);
+static_assert(type_size(Type::DECIMAL128) == 16);
+} // namespace
+
+TEST_CASE("column handles and kernel dispatch") {
+  XArrowNonNull<int16_t> small("small");
+  XArrowNonNull<double> ratio("ratio");
+  XArrowNonNull<Date32> day("day");
+  for (int i = 1; i <= 4; ++i) {
+    small.push_back(static_cast<int16_t>(i));
+    ratio.push_back(i * 0.5);
+    day.push_back(Date32{i});
+  }
+  std::vector<XArrowVariant> columns;
+  columns.emplace_back(small);
+  columns.emplace_back(ratio);
+  columns.emplace_back(day);
+
+  auto const handles = column_handles(columns);
+  REQUIRE(handles.size() == 3);
+  CHECK(handles[0].type == Type::INT16);
+  CHECK(handles[0].name == "small");
+  CHECK(handles[0].bytes() == 8);
+  CHECK(handles[1].format == "g");
+  CHECK(handles[2].length == 4);
+  CHECK(handles[1].buffers[0] == nullptr);
+  CHECK(handles[1].values<double>() ==
+        std::get<XArrowNonNull<double>>(columns[1]).data().data());
+  CHECK_THROWS_AS(handles[1].values<float>(), std::invalid_argument);
+
+  CHECK(dispatch<SumKernel>(handles[0], 1.0) == 10.0);
+  auto const sum = kernel_for<SumKernel>(handles[1].type);
+  CHECK(sum(handles[1], 2.0) == 10.0);
+  CHECK_THROWS_AS(dispatch<SumKernel>(handles[2], 1.0),
+                  std::invalid_argument);
+
+  // emplace destroys the old column before the bad format throws
+  auto &broken = columns[0];
+  CHECK_THROWS_AS(broken.emplace<XArrowNonNull<Timestamp>>("ts", "g"),
+                  std::invalid_argument);
+  REQUIRE(broken.valueless_by_exception());
+  CHECK_THROWS_AS(column_handle(broken), std::bad_variant_access);
+
+  auto const window = small.slice(1, 2);
+  auto const handle = column_handle(window);
+  CHECK(handle.length == 2);
+  CHECK(handle.values<int16_t>()[0] == 2);
+}
@@ -0,0 +1,76 @@
+#include "doctest/doctest.h"
+#include "expr.hpp"
+#include <cstdint>
+
+using namespace xarrow;
+
+namespace {
+template <class T>
+auto column(std::string_view name, size_t const n, T const start)
+    -> XArrowNonNull<T> {
+  AlignedVector<T, alignment> vec;
+  for (size_t i = 0; i < n; ++i) {
+    vec.push_back(static_cast<T>(start + static_cast<T>(i)));
+  }
+  return {name, std::move(vec)};
+}
+} // namespace
+
+TEST_CASE("fused arithmetic expression") {
+  auto const n = expr_block_rows * 2 + 5;
+  auto const a = column<int32_t>("a", n, 0);
+  auto const b = column<double>("b", n, 0.5);
+
+  auto const expr = a * 2 + b - 1;
+  static_assert(std::is_same_v<decltype(expr)::value_type, double>);
+  CHECK(expr.size() == n);
+
+  auto const out = evaluate(expr);
+  REQUIRE(out.size() == n);
+  for (size_t i = 0; i < n; ++i) {
+    CHECK(out[i] == static_cast<double>(i) * 3 - 0.5);
+  }
+
+  AlignedVector<float, alignment> narrow;
+  evaluate(-(a / 2), narrow);
+  CHECK(narrow.size() == n);
+  CHECK(narrow[7] == -3.0F);
+}
+
+TEST_CASE("expressions over slices and scalars on the left") {
+  auto const a = column<int64_t>("a", 10, 0);
+  auto const s = a.slice(4, 3);
+  auto const out = evaluate(100 - s * s);
+  REQUIRE(out.size() == 3);
+  CHECK(out[0] == 84);
+  CHECK(out[2] == 64);
+}
+
+TEST_CASE("predicate into bitmap") {
+  auto const n = expr_block_rows + 13;
+  auto const a = column<int32_t>("a", n, 0);
+  auto const b = column<int32_t>("b", n, 0);
+  auto const c = column<int32_t>("c", n, 100);
+
+  AlignedVector<uint8_t, alignment> bits;
+  auto const set = evaluate_bitmap(a * 2 + b > c, bits);
+  // 3i > i + 100  <=>  i > 50
+  CHECK(set == n - 51);
+  REQUIRE(bits.size() == (n + 7) / 8);
+  CHECK(bits[0] == 0);
+  CHECK(bits[6] == 0b11111000);
+  CHECK(bits[7] == 0xFF);
+  // 13 trailing rows, padding bits cleared
+  CHECK(bits[bits.size() - 1] == 0b00011111);
+
+  auto const both = evaluate(a > 10 && !(b >= 20));
+  CHECK_FALSE(both[10]);
+  CHECK(both[11]);
+  CHECK_FALSE(both[20]);
+}
+
+TEST_CASE("expression length checks") {
+  auto const a = column<int32_t>("a", 4, 0);
+  auto const b = column<int32_t>("b", 5, 0);
+  CHECK_THROWS_AS(a + b, std::invalid_argument);
+}
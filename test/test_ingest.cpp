@@ -0,0 +1,87 @@
+#include "doctest/doctest.h"
+#include "ingest.hpp"
+#include <cstdint>
+#include <string>
+
+using namespace xarrow;
+
+namespace {
+struct Trade {
+  int64_t id;
+  double price;
+  uint8_t side;
+  Timestamp ts;
+};
+
+constexpr auto trade_layout =
+    row_layout(field<&Trade::id>("id"), field<&Trade::price>("price"),
+               field<&Trade::side>("side"),
+               field<&Trade::ts>("ts", "tsn:UTC"));
+static_assert(decltype(trade_layout)::num_columns == 4);
+static_assert(trade_layout.fields[1].name == "price");
+} // namespace
+
+TEST_CASE("row to column ingestion") {
+  std::vector<Trade> rows;
+  size_t const n = 3000;
+  for (size_t i = 0; i < n; ++i) {
+    auto const v = static_cast<int64_t>(i);
+    rows.push_back({v, static_cast<double>(v) * 0.5,
+                    static_cast<uint8_t>(i % 2), Timestamp{v * 1000}});
+  }
+
+  RowIngestor ingestor(trade_layout);
+  ingestor.append(rows.data(), 1000);
+  ingestor.append(rows.data() + 1000, n - 1000);
+  REQUIRE(ingestor.size() == n);
+  CHECK(ingestor.column<1>()[2999] == 1499.5);
+
+  auto [id, price, side, ts] = ingestor.finish();
+  CHECK(ingestor.size() == 0);
+  CHECK(id.name() == "id");
+  CHECK(price.type_format() == "g");
+  CHECK(side.type_format() == "C");
+  CHECK(ts.type_format() == "tsn:UTC");
+  REQUIRE(id.data().size() == n);
+  for (size_t i = 0; i < n; ++i) {
+    CHECK(id.data()[i] == static_cast<int64_t>(i));
+    CHECK(side.data()[i] == i % 2);
+    CHECK(ts.data()[i].value == static_cast<int64_t>(i) * 1000);
+  }
+
+  ArrowSchema schema{};
+  price.to_schema_ref(schema);
+  CHECK(std::string(schema.name) == "price");
+}
+
+TEST_CASE("parameterized members need a format") {
+  // rejected before any row is ingested
+  CHECK_THROWS_AS(RowIngestor(row_layout(field<&Trade::id>("id"),
+                                         field<&Trade::ts>("ts"))),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(RowIngestor(row_layout(field<&Trade::id>("id", "g"))),
+                  std::invalid_argument);
+  CHECK_NOTHROW(RowIngestor(row_layout(field<&Trade::id>("id", "l"),
+                                       field<&Trade::ts>("ts", "tsu:"))));
+}
+
+TEST_CASE("ingestor outlives the layout's strings") {
+  auto const make = [] {
+    // long enough to live on the heap, freed when the lambda returns
+    std::string const name = std::string("trade_") + "identifier_column";
+    std::string const format = std::string("tsu:") + "Europe/Paris";
+    return RowIngestor(row_layout(field<&Trade::id>(name),
+                                  field<&Trade::ts>("ts", format)));
+  };
+  auto ingestor = make();
+  std::vector<Trade> const rows{{7, 0, 0, Timestamp{70}},
+                                {8, 0, 0, Timestamp{80}}};
+  ingestor.append(rows);
+  CHECK(ingestor.names()[0] == "trade_identifier_column");
+  auto [id, ts] = ingestor.finish();
+  CHECK(id.name() == "trade_identifier_column");
+  CHECK(ts.type_format() == "tsu:Europe/Paris");
+  REQUIRE(id.data().size() == 2);
+  CHECK(id.data()[1] == 8);
+  CHECK(ts.data()[0].value == 70);
+}
@@ -0,0 +1,152 @@
+#include "doctest/doctest.h"
+#include "kernels.hpp"
+#include <cstdint>
+#include <limits>
+
+using namespace xarrow;
+
+namespace {
+auto decimals(std::initializer_list<int64_t> values)
+    -> AlignedVector<Decimal128, alignment> {
+  AlignedVector<Decimal128, alignment> vec;
+  for (auto const v : values) {
+    vec.push_back(Decimal128::from_int64(v));
+  }
+  return vec;
+}
+} // namespace
+
+TEST_CASE("logical type formats") {
+  CHECK(timestamp_format(TimeUnit::NANO, "UTC") == "tsn:UTC");
+  CHECK(timestamp_format(TimeUnit::SECOND) == "tss:");
+  CHECK(duration_format(TimeUnit::MICRO) == "tDu");
+  CHECK(decimal_format({12, 2, 128}) == "d:12,2");
+  CHECK(decimal_format({40, -3, 256}) == "d:40,-3,256");
+  CHECK_THROWS_AS(decimal_format({39, 2, 128}), std::invalid_argument);
+
+  auto const params = parse_decimal_format("d:40,-3,256");
+  CHECK(params.precision == 40);
+  CHECK(params.scale == -3);
+  CHECK(params.bit_width == 256);
+  CHECK_THROWS(parse_decimal_format("d:12"));
+  CHECK_THROWS(parse_decimal_format("d:9,2,32"));
+  CHECK_THROWS(parse_decimal_format("d:18,2,64"));
+  CHECK(parse_decimal_format("d:2147483647,-2147483648").scale ==
+        std::numeric_limits<int>::min());
+  CHECK_THROWS_AS(parse_decimal_format("d:99999999999,2"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(parse_decimal_format("d:10,-2147483649"),
+                  std::runtime_error);
+  CHECK_THROWS(format2type_enum("d:18,2,64"));
+  CHECK_THROWS(format2type_enum("d:10,2,512"));
+
+  CHECK(format2type_enum("tsm:Europe/Paris") == Type::TIMESTAMP);
+  CHECK(format2type_enum("tss:") == Type::TIMESTAMP);
+  CHECK(format2type_enum("tDn") == Type::DURATION);
+  CHECK(format2type_enum("d:10,2") == Type::DECIMAL128);
+  CHECK(format2type_enum("d:60,2,256") == Type::DECIMAL256);
+  CHECK(format2type_enum("tdD") == Type::DATE32);
+  CHECK_THROWS(format2type_enum("ts"));
+  CHECK_THROWS(format2type_enum("tsx:"));
+
+  CHECK(days_from_civil(1970, 1, 1) == 0);
+  CHECK(days_from_civil(2000, 3, 1) == 11017);
+  CHECK(days_from_civil(1969, 12, 31) == -1);
+}
+
+TEST_CASE("parameterized column export") {
+  XArrowNonNull<Timestamp> ts("ts", timestamp_format(TimeUnit::MILLI, "UTC"));
+  ts.push_back({1000});
+  CHECK(ts.type_format() == "tsm:UTC");
+  CHECK_THROWS_AS(XArrowNonNull<Timestamp>("bad", "tDm"),
+                  std::invalid_argument);
+
+  ArrowSchema schema{};
+  {
+    auto const copy = ts;
+    copy.to_schema_move(schema);
+  }
+  CHECK(std::strcmp(schema.format, "tsm:UTC") == 0);
+  CHECK(std::strcmp(schema.name, "ts") == 0);
+  schema.release(&schema);
+
+  auto const s = ts.slice(0, 1);
+  CHECK(s.type_format() == "tsm:UTC");
+}
+
+TEST_CASE("decimal128 arithmetic") {
+  XArrowNonNull<Decimal128> a("a", "d:10,2", decimals({150, -1, 0, 7}));
+  XArrowNonNull<Decimal128> b("b", "d:12,2", decimals({250, 1, -5, -7}));
+
+  auto const sum = decimal128_add(a, b, "sum");
+  CHECK(sum.type_format() == "d:13,2");
+  CHECK(sum.data() == decimals({400, 0, -5, 0}));
+
+  auto const diff = decimal128_subtract(a, b, "diff");
+  CHECK(diff.type_format() == "d:13,2");
+  CHECK(diff.data() == decimals({-100, -2, 5, 14}));
+
+  auto const product = decimal128_multiply(a, b, "product");
+  CHECK(product.type_format() == "d:23,4");
+  CHECK(product.data() == decimals({37500, -1, 0, -49}));
+
+  // carry across the 64-bit boundary
+  Decimal128 const max_low{UINT64_MAX, 0};
+  Decimal128 const one = Decimal128::from_int64(1);
+  Decimal128 out{};
+  decimal128_add(&max_low, &one, &out, 1);
+  CHECK(out == Decimal128{0, 1});
+  decimal128_subtract(&out, &one, &out, 1);
+  CHECK(out == max_low);
+
+  XArrowNonNull<Decimal128> other_scale("c", "d:10,3", decimals({1, 2, 3, 4}));
+  CHECK_THROWS_AS(decimal128_add(a, other_scale, "x"), std::invalid_argument);
+  XArrowNonNull<Decimal128> shorter("d", "d:10,2", decimals({1}));
+  CHECK_THROWS_AS(decimal128_add(a, shorter, "x"), std::invalid_argument);
+
+  XArrowNonNull<Decimal128> widest("e", "d:38,2", decimals({1, 2, 3, 4}));
+  CHECK(decimal128_add(a, widest, "x").type_format() == "d:38,2");
+}
+
+TEST_CASE("decimal128 compare") {
+  XArrowNonNull<Decimal128> a("a", "d:10,2", decimals({1, -3, 5}));
+  XArrowNonNull<Decimal128> b("b", "d:10,2", decimals({1, 2, -5}));
+  auto const lt = decimal128_compare(a, b, CompareOp::LT, "lt");
+  CHECK_FALSE(lt.data()[0]);
+  CHECK(lt.data()[1]);
+  CHECK_FALSE(lt.data()[2]);
+  auto const ge = decimal128_compare(a, b, CompareOp::GE, "ge");
+  CHECK(ge.data()[0]);
+  CHECK_FALSE(ge.data()[1]);
+  CHECK(ge.data()[2]);
+  auto const ne = decimal128_compare(a, b, CompareOp::NE, "ne");
+  CHECK_FALSE(ne.data()[0]);
+  CHECK(ne.data()[2]);
+}
+
+TEST_CASE("timestamp truncate") {
+  constexpr int64_t hour = 3600LL * 1000 * 1000 * 1000;
+  AlignedVector<Timestamp, alignment> values;
+  values.push_back({5 * hour + 17});
+  values.push_back({-1});
+  values.push_back({49 * hour});
+  XArrowNonNull<Timestamp> ts("ts", timestamp_format(TimeUnit::NANO, "UTC"),
+                              std::move(values));
+
+  auto const hours = timestamp_truncate(ts, TimeGranularity::HOUR, "h");
+  CHECK(hours.type_format() == "tsn:UTC");
+  CHECK(hours.data()[0].value == 5 * hour);
+  CHECK(hours.data()[1].value == -hour);
+  CHECK(hours.data()[2].value == 49 * hour);
+
+  auto const days = timestamp_truncate(ts, TimeGranularity::DAY, "d");
+  CHECK(days.data()[0].value == 0);
+  CHECK(days.data()[1].value == -24 * hour);
+  CHECK(days.data()[2].value == 48 * hour);
+
+  Timestamp const seconds{90061};
+  Timestamp out{};
+  timestamp_truncate(&seconds, &out, 1, TimeUnit::SECOND,
+                     TimeGranularity::MINUTE);
+  CHECK(out.value == 90060);
+}
@@ -0,0 +1,105 @@
+#include "doctest/doctest.h"
+#include "live_column.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+using namespace xarrow;
+
+TEST_CASE("live column segments and snapshots") {
+  LiveColumn<int32_t> col("v", 4, 8);
+  CHECK(col.capacity() == 32);
+  for (int32_t i = 0; i < 6; ++i) {
+    col.push_back(i);
+  }
+  auto const before = col.snapshot();
+
+  std::vector<int32_t> batch{6, 7, 8, 9, 10};
+  col.append(batch.data(), batch.size());
+  CHECK(col.size() == 11);
+  CHECK(before.size() == 6);
+  CHECK(before.num_chunks() == 2);
+
+  auto const after = col.snapshot();
+  REQUIRE(after.size() == 11);
+  CHECK(after.num_chunks() == 3);
+  for (size_t i = 0; i < after.size(); ++i) {
+    CHECK(after[i] == static_cast<int32_t>(i));
+  }
+  // segments never move, so older snapshots share them
+  CHECK(before.chunk(0).data() == after.chunk(0).data());
+
+  std::vector<int32_t> too_many(32, 0);
+  CHECK_THROWS_AS(col.append(too_many.data(), too_many.size()),
+                  std::length_error);
+  CHECK(col.size() == 11);
+}
+
+TEST_CASE("live column stream export") {
+  ArrowArrayStream stream{};
+  {
+    LiveColumn<double> col("x", 3);
+    for (int i = 0; i < 7; ++i) {
+      col.push_back(i * 1.5);
+    }
+    col.to_stream_move(stream);
+  }
+  ArrowSchema schema{};
+  REQUIRE(stream.get_schema(&stream, &schema) == 0);
+  CHECK(std::string(schema.format) == "g");
+  CHECK(std::string(schema.name) == "x");
+  schema.release(&schema);
+
+  std::vector<int64_t> lengths;
+  double last = 0;
+  while (true) {
+    ArrowArray array{};
+    REQUIRE(stream.get_next(&stream, &array) == 0);
+    if (array.release == nullptr) {
+      break;
+    }
+    lengths.push_back(array.length);
+    last = static_cast<double const *>(array.buffers[1])[array.length - 1];
+    array.release(&array);
+  }
+  CHECK(lengths == std::vector<int64_t>{3, 3, 1});
+  CHECK(last == 9.0);
+  CHECK(stream.get_last_error(&stream) == nullptr);
+  stream.release(&stream);
+  CHECK(stream.release == nullptr);
+}
+
+TEST_CASE("concurrent append and snapshot") {
+  LiveColumn<int64_t> col("seq", 256);
+  constexpr int64_t total = 50000;
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    std::array<int64_t, 100> batch{};
+    for (int64_t i = 0; i < total; i += 100) {
+      for (int64_t j = 0; j < 100; ++j) {
+        batch[static_cast<size_t>(j)] = i + j;
+      }
+      col.append(batch.data(), batch.size());
+    }
+    done = true;
+  });
+
+  size_t previous = 0;
+  bool consistent = true;
+  while (!done) {
+    auto const snap = col.snapshot();
+    // batches are published whole, and the length only grows
+    consistent =
+        consistent && snap.size() % 100 == 0 && snap.size() >= previous;
+    if (!snap.empty()) {
+      consistent = consistent && snap[snap.size() - 1] ==
+                                     static_cast<int64_t>(snap.size() - 1);
+    }
+    previous = snap.size();
+  }
+  writer.join();
+  CHECK(consistent);
+  CHECK(col.size() == total);
+  CHECK(col.snapshot()[total - 1] == total - 1);
+}
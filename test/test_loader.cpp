@@ -0,0 +1,168 @@
+#include "doctest/doctest.h"
+#include "loader.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+
+using namespace xarrow;
+
+namespace {
+struct TempFile {
+  explicit TempFile(std::string const &content) {
+    std::array<char, 32> name{"/tmp/xarrow_loaderXXXXXX"};
+    auto const fd = mkstemp(name.data());
+    REQUIRE(fd >= 0);
+    path = name.data();
+    REQUIRE(write(fd, content.data(), content.size()) ==
+            static_cast<ssize_t>(content.size()));
+    close(fd);
+  }
+  TempFile(const TempFile &) = delete;
+  auto operator=(const TempFile &) -> TempFile & = delete;
+  ~TempFile() { std::remove(path.c_str()); }
+  std::string path;
+};
+
+auto small_chunks(IoBackend const backend) -> LoadOptions {
+  LoadOptions options;
+  options.chunk_bytes = direct_alignment;
+  options.queue_depth = 3;
+  options.backend = backend;
+  return options;
+}
+} // namespace
+
+TEST_CASE("loader reads chunks in order") {
+  std::string content;
+  for (int i = 0; i < 5000; ++i) {
+    content += std::to_string(i) + ";";
+  }
+  TempFile file(content);
+  for (auto const backend : {IoBackend::AUTO, IoBackend::THREADS}) {
+    std::string seen;
+    size_t chunks = 0;
+    auto const used =
+        read_chunks(file.path.c_str(), small_chunks(backend),
+                    [&](const std::byte *data, size_t const size) {
+                      seen.append(reinterpret_cast<const char *>(data), size);
+                      ++chunks;
+                    });
+    CHECK(seen == content);
+    CHECK(chunks == (content.size() + direct_alignment - 1) / direct_alignment);
+    if (backend == IoBackend::THREADS) {
+      CHECK(used == IoBackend::THREADS);
+    }
+  }
+}
+
+TEST_CASE("loader binary column") {
+  std::string content(sizeof(int64_t) * 3000, '\0');
+  for (int64_t i = 0; i < 3000; ++i) {
+    std::memcpy(content.data() + i * sizeof(int64_t), &i, sizeof(i));
+  }
+  TempFile file(content);
+  auto options = small_chunks(IoBackend::THREADS);
+  options.direct = true;
+  auto col = load_binary<int64_t>(file.path.c_str(), "v", options);
+  REQUIRE(col.data().size() == 3000);
+  // read in place, the column storage is what O_DIRECT transferred into
+  CHECK(reinterpret_cast<uintptr_t>(col.data().data()) % direct_alignment ==
+        0);
+  CHECK(col.data()[0] == 0);
+  CHECK(col.data()[2999] == 2999);
+
+  auto const uring = load_binary<int64_t>(file.path.c_str(), "v",
+                                          small_chunks(IoBackend::AUTO));
+  CHECK(uring.data() == col.data());
+
+  CHECK_THROWS_AS(load_binary<int32_t>("/nonexistent/xarrow", "v"),
+                  std::system_error);
+  TempFile odd("abc");
+  CHECK_THROWS_AS(load_binary<int32_t>(odd.path.c_str(), "v"),
+                  std::runtime_error);
+
+  // asking for more than the file holds returns what is there
+  std::vector<std::byte> dst(2 * direct_alignment);
+  CHECK(read_into(odd.path.c_str(), dst.data(), dst.size() - 1) == 3);
+  CHECK(dst[2] == std::byte{'c'});
+}
+
+TEST_CASE("loader csv numeric columns") {
+  std::string content = "id,score,flag,small\r\n";
+  for (int i = 0; i < 2000; ++i) {
+    content += std::to_string(i) + ", " + std::to_string(i * 0.25) + "," +
+               (i % 2 == 0 ? "true" : "0") + "," +
+               std::to_string(i % 100 - 50) + "\r\n";
+  }
+  TempFile file(content);
+  auto columns = load_csv(file.path.c_str(),
+                          {{"id", Type::UINT32},
+                           {"score", Type::FLOAT64},
+                           {"flag", Type::BOOL},
+                           {"small", Type::INT8}},
+                          {}, small_chunks(IoBackend::AUTO));
+  REQUIRE(columns.size() == 4);
+  auto &id = std::get<XArrowNonNull<uint32_t>>(columns[0]);
+  auto &score = std::get<XArrowNonNull<double>>(columns[1]);
+  auto &flag = std::get<XArrowNonNull<bool>>(columns[2]);
+  auto &small = std::get<XArrowNonNull<int8_t>>(columns[3]);
+  REQUIRE(id.data().size() == 2000);
+  CHECK(id.name() == "id");
+  CHECK(id.data()[1999] == 1999);
+  CHECK(score.data()[3] == 0.75);
+  CHECK(flag.data()[0]);
+  CHECK_FALSE(flag.data()[1]);
+  CHECK(small.data()[99] == 49);
+  CHECK(small.data()[100] == -50);
+}
+
+TEST_CASE("loader csv errors") {
+  std::vector<CsvColumn> const two{{"a", Type::INT32}, {"b", Type::INT32}};
+  CsvOptions const no_header{',', false};
+  TempFile bad("1,2\n3,x\n");
+  CHECK_THROWS_AS((load_csv(bad.path.c_str(), two, no_header)),
+                  std::runtime_error);
+  TempFile short_line("1,2\n3\n");
+  CHECK_THROWS_AS((load_csv(short_line.path.c_str(), two, no_header)),
+                  std::runtime_error);
+  // rows are parsed in batches, the first bad line is still the one named
+  std::string many;
+  for (int i = 1; i <= 9000; ++i) {
+    many += i == 8500 ? "1,x\n" : i == 8700 ? "y,1\n" : "1,2\n";
+  }
+  TempFile late(many);
+  for (auto const &options : {LoadOptions{}, small_chunks(IoBackend::AUTO)}) {
+    std::string error;
+    try {
+      (void)load_csv(late.path.c_str(), two, no_header, options);
+    } catch (std::runtime_error const &e) {
+      error = e.what();
+    }
+    CHECK(error == "load_csv: bad value at line 8500");
+  }
+  TempFile overflow("300\n");
+  CHECK_THROWS_AS(
+      (load_csv(overflow.path.c_str(), {{"a", Type::UINT8}}, no_header)),
+      std::runtime_error);
+}
+
+TEST_CASE("loader csv temporal columns") {
+  TempFile file("day,at\n1970-01-02,1500\n2000-03-01,-20\n");
+  auto columns = load_csv(
+      file.path.c_str(),
+      {{"day", Type::DATE32}, {"at", Type::TIMESTAMP, "tsm:UTC"}});
+  auto &day = std::get<XArrowNonNull<Date32>>(columns[0]);
+  auto &at = std::get<XArrowNonNull<Timestamp>>(columns[1]);
+  REQUIRE(day.data().size() == 2);
+  CHECK(day.data()[0].value == 1);
+  CHECK(day.data()[1].value == 11017);
+  CHECK(at.type_format() == "tsm:UTC");
+  CHECK(at.data()[1].value == -20);
+
+  CHECK_THROWS_AS(
+      (load_csv(file.path.c_str(), {{"d", Type::DECIMAL128, "d:10,2"}})),
+      std::invalid_argument);
+}
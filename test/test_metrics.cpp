@@ -0,0 +1,93 @@
+#include "doctest/doctest.h"
+#include "expr.hpp"
+#include "metrics.hpp"
+#include "xarrow.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace xarrow;
+
+#if XARROW_METRICS
+namespace {
+auto delta(metrics::Snapshot const &before, metrics::Snapshot const &after,
+           metrics::Counter const counter) -> int64_t {
+  return after[counter] - before[counter];
+}
+} // namespace
+
+TEST_CASE("allocation and reallocation counters") {
+  auto const before = metrics::snapshot();
+  {
+    AlignedVector<int64_t, alignment> vec;
+    for (int64_t i = 0; i < 100; ++i) {
+      vec.push_back(i);
+    }
+    auto const during = metrics::snapshot();
+    CHECK(delta(before, during, metrics::Counter::BYTES_LIVE) ==
+          static_cast<int64_t>(align_round(vec.capacity() * 8, alignment)));
+    CHECK(delta(before, during, metrics::Counter::REALLOC_BYTES_COPIED) > 0);
+    CHECK(delta(before, during, metrics::Counter::ALLOCATIONS) > 1);
+  }
+  auto const after = metrics::snapshot();
+  CHECK(delta(before, after, metrics::Counter::BYTES_LIVE) == 0);
+  CHECK(delta(before, after, metrics::Counter::BYTES_ALLOCATED) > 0);
+
+  uint64_t histogram_before = 0;
+  uint64_t histogram_after = 0;
+  for (size_t i = 0; i < metrics::histogram_buckets; ++i) {
+    histogram_before += before.allocation_bytes[i];
+    histogram_after += after.allocation_bytes[i];
+  }
+  CHECK(static_cast<int64_t>(histogram_after - histogram_before) ==
+        delta(before, after, metrics::Counter::ALLOCATIONS));
+}
+
+TEST_CASE("outstanding exports") {
+  auto const before = metrics::snapshot();
+  XArrowNonNull<int32_t> col("a");
+  col.push_back(1);
+  ArrowArray array{};
+  col.to_array_move(array);
+  auto const exported = metrics::snapshot();
+  CHECK(delta(before, exported, metrics::Counter::EXPORTS) == 1);
+  CHECK(delta(before, exported, metrics::Counter::EXPORTS_OUTSTANDING) == 1);
+
+  // released from another thread, whose counters outlive it
+  std::thread([&array] { array.release(&array); }).join();
+  auto const released = metrics::snapshot();
+  CHECK(delta(before, released, metrics::Counter::EXPORTS_OUTSTANDING) == 0);
+}
+
+TEST_CASE("columns freed after the thread's counters are gone") {
+  auto const before = metrics::snapshot();
+  std::thread([] {
+    // constructed before this thread's counters, so destroyed after them
+    thread_local std::optional<XArrowNonNull<int64_t>> late;
+    late.emplace("late");
+    late->detach().resize(1000);
+  }).join();
+  auto const after = metrics::snapshot();
+  CHECK(delta(before, after, metrics::Counter::BYTES_LIVE) == 0);
+  CHECK(delta(before, after, metrics::Counter::ALLOCATIONS) > 0);
+
+  // same on the main thread: freed at exit, after its thread_locals
+  static std::optional<XArrowNonNull<int64_t>> at_exit;
+  at_exit.emplace("at_exit");
+  at_exit->detach().resize(1000);
+}
+
+TEST_CASE("kernel timing") {
+  AlignedVector<int32_t, alignment> vec(4096);
+  XArrowNonNull<int32_t> const col("a", std::move(vec));
+  auto const before = metrics::snapshot();
+  auto const out = evaluate(col * 2 + 1);
+  auto const after = metrics::snapshot();
+  CHECK(delta(before, after, metrics::Counter::KERNEL_CALLS) == 1);
+  CHECK(delta(before, after, metrics::Counter::KERNEL_ROWS) == 4096);
+  CHECK(after.kernel_ns_per_row() >= 0);
+  CHECK(std::string(metrics::counter_name(
+            metrics::Counter::EXPORTS_OUTSTANDING)) == "exports_outstanding");
+}
+#endif
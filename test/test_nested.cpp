@@ -0,0 +1,103 @@
+#include "doctest/doctest.h"
+#include "kernels.hpp"
+#include "nested.hpp"
+#include <cstdint>
+#include <string>
+
+using namespace xarrow;
+
+TEST_CASE("list builder") {
+  XArrowList<int32_t> list("ids");
+  list.append({1, 2, 3});
+  list.append({});
+  list.append({4});
+  REQUIRE(list.size() == 3);
+  CHECK(list.row_size(0) == 3);
+  CHECK(list.row_size(1) == 0);
+  CHECK(list.row_data(2)[0] == 4);
+
+  ArrowSchema schema{};
+  list.to_schema_ref(schema);
+  CHECK(std::string(schema.format) == "+l");
+  CHECK(std::string(schema.name) == "ids");
+  REQUIRE(schema.n_children == 1);
+  CHECK(std::string(schema.children[0]->format) == "i");
+  CHECK(std::string(schema.children[0]->name) == "item");
+  schema.release(&schema);
+
+  ArrowArray array{};
+  list.to_array_move(array);
+  CHECK(list.size() == 0);
+  CHECK(array.length == 3);
+  CHECK(array.n_buffers == 2);
+  auto const *offsets = static_cast<int32_t const *>(array.buffers[1]);
+  CHECK(offsets[0] == 0);
+  CHECK(offsets[1] == 3);
+  CHECK(offsets[3] == 4);
+  REQUIRE(array.n_children == 1);
+  auto const *child = array.children[0];
+  CHECK(child->length == 4);
+  CHECK(static_cast<int32_t const *>(child->buffers[1])[3] == 4);
+  array.release(&array);
+  CHECK(array.release == nullptr);
+}
+
+TEST_CASE("large list builder") {
+  XArrowLargeList<double> list("values");
+  list.append({1.5, 2.5});
+  ArrowSchema schema{};
+  list.to_schema_move(schema);
+  CHECK(std::string(schema.format) == "+L");
+  CHECK(std::string(schema.children[0]->format) == "g");
+  schema.release(&schema);
+  CHECK(schema.release == nullptr);
+
+  ArrowArray array{};
+  list.to_array_ref(array);
+  CHECK(static_cast<int64_t const *>(array.buffers[1])[1] == 2);
+  CHECK(array.children[0]->buffers[1] == list.values().data());
+  array.release(&array);
+}
+
+TEST_CASE("fixed size list builder") {
+  XArrowFixedSizeList<float, 4> embeddings("embedding");
+  embeddings.reserve(3);
+  embeddings.append({0, 0, 0, 0});
+  embeddings.append({1, 2, 3, 4});
+  embeddings.append({1, 1, 1, 1});
+  REQUIRE(embeddings.size() == 3);
+  CHECK(embeddings[1][2] == 3);
+  CHECK(reinterpret_cast<uintptr_t>(embeddings.values().data()) % alignment ==
+        0);
+
+  ArrowSchema schema{};
+  embeddings.to_schema_move(schema);
+  CHECK(std::string(schema.format) == "+w:4");
+  CHECK(std::string(schema.children[0]->format) == "f");
+  schema.release(&schema);
+
+  ArrowArray array{};
+  embeddings.to_array_move(array);
+  CHECK(array.length == 3);
+  CHECK(array.n_buffers == 1);
+  CHECK(array.children[0]->length == 12);
+  CHECK(static_cast<float const *>(array.children[0]->buffers[1])[7] == 4);
+  array.release(&array);
+}
+
+TEST_CASE("l2 distance over fixed size lists") {
+  XArrowFixedSizeList<float, 20> rows("embedding");
+  std::array<float, 20> row{};
+  rows.append(row);
+  row.fill(1);
+  rows.append(row);
+  row[19] = 3;
+  rows.append(row);
+
+  std::array<float, 20> query{};
+  std::array<float, 3> out{};
+  l2_squared(rows, query.data(), out.data());
+  CHECK(out[0] == 0);
+  CHECK(out[1] == 20);
+  CHECK(out[2] == 28);
+}
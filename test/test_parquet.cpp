@@ -0,0 +1,514 @@
+#include "doctest/doctest.h"
+#include "loader.hpp"
+#include "parquet.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unistd.h>
+
+using namespace xarrow;
+
+// checked-in reference files, the build points this at test/data
+#ifndef XARROW_TEST_DATA
+#define XARROW_TEST_DATA "test/data"
+#endif
+
+namespace {
+// decoded Thrift compact value: ints and bools in i, strings in bytes
+struct Node {
+  int64_t i = 0;
+  std::string bytes;
+  std::vector<Node> list;
+  std::map<int16_t, Node> fields;
+
+  auto operator[](int16_t const id) const -> Node const & {
+    return fields.at(id);
+  }
+  [[nodiscard]] auto has(int16_t const id) const -> bool {
+    return fields.count(id) != 0;
+  }
+};
+
+struct ThriftReader {
+  const uint8_t *pos;
+
+  auto varint() -> uint64_t {
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+      auto const byte = *pos++;
+      v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return v;
+      }
+    }
+  }
+  auto zigzag() -> int64_t {
+    auto const v = varint();
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+  }
+  auto value(uint8_t const type) -> Node {
+    Node node;
+    switch (type) {
+    case 1:
+    case 2:
+      node.i = type == 1 ? 1 : 0;
+      break;
+    case 3:
+      node.i = static_cast<int8_t>(*pos++);
+      break;
+    case 4:
+    case 5:
+    case 6:
+      node.i = zigzag();
+      break;
+    case 8: {
+      auto const size = varint();
+      node.bytes.assign(reinterpret_cast<const char *>(pos), size);
+      pos += size;
+      break;
+    }
+    case 9: {
+      auto const header = *pos++;
+      size_t size = header >> 4;
+      if (size == 15) {
+        size = varint();
+      }
+      for (size_t k = 0; k < size; ++k) {
+        node.list.push_back(value(header & 0x0f));
+      }
+      break;
+    }
+    case 12:
+      node = structure();
+      break;
+    default:
+      throw std::runtime_error("unexpected thrift type");
+    }
+    return node;
+  }
+  auto structure() -> Node {
+    Node node;
+    int16_t last = 0;
+    while (true) {
+      auto const header = *pos++;
+      if (header == 0) {
+        return node;
+      }
+      auto const delta = header >> 4;
+      last = static_cast<int16_t>(delta != 0 ? last + delta : zigzag());
+      node.fields[last] = value(header & 0x0f);
+    }
+  }
+};
+
+auto lz4_decompress(std::string const &src, size_t const size)
+    -> std::string {
+  std::string out;
+  size_t pos = 0;
+  auto const length = [&](size_t n) {
+    if (n == 15) {
+      uint8_t byte = 0;
+      do {
+        byte = static_cast<uint8_t>(src[pos++]);
+        n += byte;
+      } while (byte == 255);
+    }
+    return n;
+  };
+  while (pos < src.size()) {
+    auto const token = static_cast<uint8_t>(src[pos++]);
+    auto const literals = length(token >> 4);
+    out.append(src, pos, literals);
+    pos += literals;
+    if (pos == src.size()) {
+      break;
+    }
+    auto const low = static_cast<uint8_t>(src[pos]);
+    auto const high = static_cast<uint8_t>(src[pos + 1]);
+    size_t const offset = low | static_cast<size_t>(high) << 8;
+    pos += 2;
+    auto const match = length(token & 0x0f) + 4;
+    for (size_t k = 0; k < match; ++k) {
+      out.push_back(out[out.size() - offset]);
+    }
+  }
+  REQUIRE(out.size() == size);
+  return out;
+}
+
+auto rle_decode(const uint8_t *pos, size_t const n, int const bit_width)
+    -> std::vector<uint32_t> {
+  ThriftReader reader{pos};
+  std::vector<uint32_t> out;
+  while (out.size() < n) {
+    auto const header = reader.varint();
+    if ((header & 1) == 0) {
+      uint32_t value = 0;
+      for (int byte = 0; byte < (bit_width + 7) / 8; ++byte) {
+        value |= static_cast<uint32_t>(*reader.pos++) << (8 * byte);
+      }
+      out.insert(out.end(), header >> 1, value);
+      continue;
+    }
+    auto const count = (header >> 1) * 8;
+    for (size_t k = 0; k < count; ++k) {
+      uint32_t value = 0;
+      for (int b = 0; b < bit_width; ++b) {
+        auto const bit = k * static_cast<size_t>(bit_width) +
+                         static_cast<size_t>(b);
+        value |= ((reader.pos[bit / 8] >> (bit % 8)) & 1U) << b;
+      }
+      out.push_back(value);
+    }
+    reader.pos += count * static_cast<size_t>(bit_width) / 8;
+  }
+  out.resize(n);
+  return out;
+}
+
+struct ParquetFile {
+  std::string bytes;
+  Node meta;
+
+  explicit ParquetFile(int const fd) {
+    REQUIRE(lseek(fd, 0, SEEK_SET) == 0);
+    std::array<char, 4096> buffer{};
+    ssize_t n = 0;
+    while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+      bytes.append(buffer.data(), static_cast<size_t>(n));
+    }
+    REQUIRE(bytes.size() > 12);
+    REQUIRE(bytes.compare(0, 4, "PAR1") == 0);
+    REQUIRE(bytes.compare(bytes.size() - 4, 4, "PAR1") == 0);
+    uint32_t length = 0;
+    std::memcpy(&length, bytes.data() + bytes.size() - 8, sizeof(length));
+    REQUIRE(length + 12 <= bytes.size());
+    ThriftReader reader{reinterpret_cast<const uint8_t *>(bytes.data()) +
+                        bytes.size() - 8 - length};
+    meta = reader.structure();
+    CHECK(reader.pos ==
+          reinterpret_cast<const uint8_t *>(bytes.data()) + bytes.size() - 8);
+  }
+
+  // values of column c across all row groups, P is the PLAIN type
+  template <class P> auto column(size_t const c) const -> std::vector<P> {
+    std::vector<P> values;
+    for (auto const &group : meta[4].list) {
+      auto const &chunk = group[1].list.at(c)[3];
+      std::vector<P> dictionary;
+      auto pos = static_cast<size_t>(chunk.has(11) ? chunk[11].i : chunk[9].i);
+      auto const end = values.size() + static_cast<size_t>(chunk[5].i);
+      while (values.size() < end) {
+        ThriftReader reader{
+            reinterpret_cast<const uint8_t *>(bytes.data()) + pos};
+        auto const header = reader.structure();
+        pos = static_cast<size_t>(
+            reader.pos - reinterpret_cast<const uint8_t *>(bytes.data()));
+        auto body = bytes.substr(pos, static_cast<size_t>(header[3].i));
+        pos += body.size();
+        if (chunk[4].i == 7) {
+          body = lz4_decompress(body, static_cast<size_t>(header[2].i));
+        } else {
+          REQUIRE(chunk[4].i == 0);
+        }
+        if (header[1].i == 2) {
+          if constexpr (!std::is_same_v<P, bool>) {
+            dictionary.resize(static_cast<size_t>(header[7][1].i));
+            std::memcpy(dictionary.data(), body.data(), body.size());
+          }
+          continue;
+        }
+        auto const n = static_cast<size_t>(header[5][1].i);
+        auto const *data = reinterpret_cast<const uint8_t *>(body.data());
+        if (header[5][2].i == 8) {
+          for (auto const index : rle_decode(data + 1, n, data[0])) {
+            values.push_back(dictionary.at(index));
+          }
+        } else if constexpr (std::is_same_v<P, bool>) {
+          for (size_t k = 0; k < n; ++k) {
+            values.push_back(((data[k / 8] >> (k % 8)) & 1) != 0);
+          }
+        } else {
+          auto const old = values.size();
+          values.resize(old + n);
+          std::memcpy(values.data() + old, data, n * sizeof(P));
+        }
+      }
+    }
+    return values;
+  }
+};
+
+template <class P> auto plain_value(std::string const &bytes) -> P {
+  P value{};
+  REQUIRE(bytes.size() == sizeof(P));
+  std::memcpy(&value, bytes.data(), sizeof(P));
+  return value;
+}
+} // namespace
+
+TEST_CASE("parquet plain and dictionary chunks") {
+  auto *file = std::tmpfile();
+  REQUIRE(file != nullptr);
+  size_t const n = 1000;
+  XArrowNonNull<int64_t> id("id");
+  XArrowNonNull<int32_t> bucket("bucket");
+  XArrowNonNull<double> price("price");
+  XArrowNonNull<bool> flag("flag");
+  for (size_t i = 0; i < n; ++i) {
+    id.push_back(static_cast<int64_t>(i) - 500);
+    // long runs and short mixed stretches exercise both hybrid run kinds
+    bucket.push_back(
+        static_cast<int32_t>(i < 500 ? i / 50 % 5 : i % 3));
+    price.push_back(static_cast<double>(i) * 0.25);
+    flag.push_back(i % 3 == 0);
+  }
+
+  ParquetOptions options;
+  options.row_group_rows = 600;
+  options.page_bytes = 256;
+  options.threads = 3;
+  {
+    ParquetWriter writer(fileno(file), options);
+    writer.write(id, bucket, price, flag);
+    CHECK(writer.rows_written() == static_cast<int64_t>(n));
+    writer.close();
+  }
+
+  ParquetFile const parquet(fileno(file));
+  auto const &meta = parquet.meta;
+  CHECK(meta[3].i == static_cast<int64_t>(n));
+  REQUIRE(meta[2].list.size() == 5);
+  CHECK(meta[2].list[0][5].i == 4);
+  CHECK(meta[2].list[1][4].bytes == "id");
+  CHECK(meta[2].list[1][1].i == 2);
+  CHECK(meta[2].list[2][10][10][1].i == 32);
+  REQUIRE(meta[4].list.size() == 2);
+  CHECK(meta[4].list[1][3].i == 400);
+
+  auto const &group = meta[4].list[0];
+  // distinct ids stay PLAIN, the buckets get a dictionary
+  CHECK_FALSE(group[1].list[0][3].has(11));
+  CHECK(group[1].list[1][3].has(11));
+  auto const &stats = group[1].list[0][3][12];
+  CHECK(plain_value<int64_t>(stats[6].bytes) == -500);
+  CHECK(plain_value<int64_t>(stats[5].bytes) == 99);
+
+  auto const ids = parquet.column<int64_t>(0);
+  auto const buckets = parquet.column<int32_t>(1);
+  auto const prices = parquet.column<double>(2);
+  auto const flags = parquet.column<bool>(3);
+  REQUIRE(ids.size() == n);
+  REQUIRE(buckets.size() == n);
+  REQUIRE(prices.size() == n);
+  REQUIRE(flags.size() == n);
+  bool same = true;
+  for (size_t i = 0; i < n; ++i) {
+    same = same && ids[i] == id.data()[i] && buckets[i] == bucket.data()[i] &&
+           prices[i] == price.data()[i] && flags[i] == flag.data()[i];
+  }
+  CHECK(same);
+  std::fclose(file);
+}
+
+TEST_CASE("parquet lz4 pages and logical types") {
+  auto *file = std::tmpfile();
+  REQUIRE(file != nullptr);
+  XArrowNonNull<uint16_t> code("code");
+  XArrowNonNull<Timestamp> ts("ts", "tsu:UTC");
+  XArrowNonNull<Decimal128> amount("amount", "d:12,2");
+  for (int64_t i = 0; i < 4000; ++i) {
+    code.push_back(static_cast<uint16_t>(60000 + i % 7));
+    ts.push_back(Timestamp{i * 1000});
+    amount.push_back(Decimal128::from_int64(i - 2000));
+  }
+
+  ParquetOptions options;
+  options.compression = ParquetCompression::LZ4_RAW;
+  options.dictionary = false;
+  {
+    ParquetWriter writer(fileno(file), options);
+    std::vector<XArrowVariant> columns;
+    columns.emplace_back(code);
+    columns.emplace_back(ts);
+    columns.emplace_back(amount);
+    writer.write(columns);
+    writer.write(columns);
+    // both batches fit one row group, written with the footer by the
+    // destructor
+    CHECK(writer.bytes_written() == 4);
+  }
+
+  ParquetFile const parquet(fileno(file));
+  auto const &schema = parquet.meta[2].list;
+  CHECK(schema[1][6].i == 12);
+  CHECK(schema[1][10][10][2].i == 0);
+  CHECK(schema[2][6].i == 10);
+  CHECK(schema[2][10][8][1].i == 1);
+  CHECK(schema[3][1].i == 7);
+  CHECK(schema[3][2].i == 16);
+  CHECK(schema[3][8].i == 12);
+  CHECK(schema[3][7].i == 2);
+  REQUIRE(parquet.meta[4].list.size() == 1);
+
+  auto const &chunk = parquet.meta[4].list[0][1].list[0][3];
+  CHECK(chunk[4].i == 7);
+  CHECK(chunk[7].i < chunk[6].i / 2);
+
+  auto const codes = parquet.column<int32_t>(0);
+  auto const stamps = parquet.column<int64_t>(1);
+  auto const amounts = parquet.column<std::array<uint8_t, 16>>(2);
+  REQUIRE(codes.size() == 8000);
+  REQUIRE(amounts.size() == 8000);
+  CHECK(codes[7999] == 60000 + 3999 % 7);
+  CHECK(stamps[4001] == 1000);
+  // big-endian -2000
+  CHECK(amounts[0][0] == 0xff);
+  CHECK(amounts[0][14] == 0xf8);
+  CHECK(amounts[0][15] == 0x30);
+  std::fclose(file);
+}
+
+TEST_CASE("parquet row groups span write calls") {
+  auto *file = std::tmpfile();
+  REQUIRE(file != nullptr);
+  XArrowNonNull<int32_t> value("value");
+  for (int32_t i = 0; i < 1000; ++i) {
+    value.push_back(i * 3);
+  }
+
+  ParquetOptions options;
+  options.row_group_rows = 300;
+  {
+    ParquetWriter writer(fileno(file), options);
+    for (size_t begin = 0; begin < 1000; begin += 70) {
+      auto const batch =
+          value.slice(begin, std::min<size_t>(70, 1000 - begin));
+      writer.write(std::vector<ColumnHandle>{column_handle(batch)});
+      CHECK(writer.rows_written() ==
+            static_cast<int64_t>(begin + batch.size()));
+    }
+    // a batch larger than a group tops up the buffer, then writes directly
+    writer.write(value);
+    writer.close();
+  }
+
+  ParquetFile const parquet(fileno(file));
+  auto const &groups = parquet.meta[4].list;
+  REQUIRE(groups.size() == 7);
+  for (size_t g = 0; g + 1 < groups.size(); ++g) {
+    CHECK(groups[g][3].i == 300);
+  }
+  CHECK(groups.back()[3].i == 200);
+  auto const values = parquet.column<int32_t>(0);
+  REQUIRE(values.size() == 2000);
+  bool same = true;
+  for (size_t i = 0; i < values.size(); ++i) {
+    same = same && values[i] == value.data()[i % 1000];
+  }
+  CHECK(same);
+  std::fclose(file);
+}
+
+TEST_CASE("parquet writer rejects bad batches") {
+  auto *file = std::tmpfile();
+  REQUIRE(file != nullptr);
+  XArrowNonNull<int32_t> a("a");
+  XArrowNonNull<int32_t> b("b");
+  XArrowNonNull<Date64> d("d");
+  a.push_back(1);
+  a.push_back(2);
+  b.push_back(3);
+  d.push_back(Date64{4});
+
+  ParquetWriter writer(fileno(file));
+  CHECK_THROWS_AS(writer.write(a, b), std::invalid_argument);
+  CHECK_THROWS_AS(writer.write(d), std::invalid_argument);
+  writer.write(a);
+  CHECK_THROWS_AS(writer.write(b), std::invalid_argument);
+  writer.close();
+  CHECK_THROWS_AS(writer.write(a), std::runtime_error);
+#ifndef XARROW_WITH_ZSTD
+  ParquetOptions zstd;
+  zstd.compression = ParquetCompression::ZSTD;
+  CHECK_THROWS_AS(ParquetWriter(fileno(file), zstd), std::invalid_argument);
+#endif
+  std::fclose(file);
+}
+
+TEST_CASE("parquet output matches the golden file") {
+  // batches of 7 rows fill groups of 16, "small" outgrows its dictionary
+  // part way into the second batch
+  XArrowNonNull<int64_t> id("id");
+  XArrowNonNull<int32_t> small("small");
+  XArrowNonNull<int32_t> bucket("bucket");
+  XArrowNonNull<double> price("price");
+  XArrowNonNull<bool> flag("flag");
+  XArrowNonNull<Date32> day("day");
+  for (int32_t i = 0; i < 40; ++i) {
+    id.push_back(int64_t{i} * 1000003 - 7);
+    small.push_back(i % 12);
+    bucket.push_back(i / 5 % 3);
+    price.push_back(i * 0.125 - 2);
+    flag.push_back(i % 3 == 1);
+    day.push_back(Date32{19000 + i * 3});
+  }
+
+  auto *file = std::tmpfile();
+  REQUIRE(file != nullptr);
+  ParquetOptions options;
+  options.row_group_rows = 16;
+  options.page_bytes = 16;
+  options.dictionary_max_entries = 8;
+  options.threads = 2;
+  {
+    ParquetWriter writer(fileno(file), options);
+    for (size_t begin = 0; begin < 40; begin += 7) {
+      auto const n = std::min<size_t>(7, 40 - begin);
+      writer.write(std::vector<ColumnHandle>{
+          column_handle(id.slice(begin, n)),
+          column_handle(small.slice(begin, n)),
+          column_handle(bucket.slice(begin, n)),
+          column_handle(price.slice(begin, n)),
+          column_handle(flag.slice(begin, n)),
+          column_handle(day.slice(begin, n))});
+    }
+    writer.close();
+  }
+
+  // golden.csv is pyarrow's reading of golden.parquet, see
+  // scripts/parquet_golden.py
+  std::string const data = XARROW_TEST_DATA;
+  auto const csv = load_csv((data + "/golden.csv").c_str(),
+                            {{"id", Type::INT64},
+                             {"small", Type::INT32},
+                             {"bucket", Type::INT32},
+                             {"price", Type::FLOAT64},
+                             {"flag", Type::BOOL},
+                             {"day", Type::DATE32}});
+  auto const &ids = std::get<XArrowNonNull<int64_t>>(csv[0]).data();
+  auto const &smalls = std::get<XArrowNonNull<int32_t>>(csv[1]).data();
+  auto const &buckets = std::get<XArrowNonNull<int32_t>>(csv[2]).data();
+  auto const &prices = std::get<XArrowNonNull<double>>(csv[3]).data();
+  auto const &flags = std::get<XArrowNonNull<bool>>(csv[4]).data();
+  auto const &days = std::get<XArrowNonNull<Date32>>(csv[5]).data();
+  REQUIRE(ids.size() == 40);
+  bool same = true;
+  for (size_t i = 0; i < 40; ++i) {
+    same = same && ids[i] == id.data()[i] && smalls[i] == small.data()[i] &&
+           buckets[i] == bucket.data()[i] && prices[i] == price.data()[i] &&
+           flags[i] == flag.data()[i] &&
+           days[i].value == day.data()[i].value;
+  }
+  CHECK(same);
+
+  std::ifstream golden(data + "/golden.parquet", std::ios::binary);
+  REQUIRE(golden.good());
+  std::string const expected((std::istreambuf_iterator<char>(golden)),
+                             std::istreambuf_iterator<char>());
+  CHECK(ParquetFile(fileno(file)).bytes == expected);
+  std::fclose(file);
+}
@@ -0,0 +1,243 @@
+#include "doctest/doctest.h"
+#include "shm.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace xarrow;
+
+namespace {
+struct SocketPair {
+  SocketPair() {
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) == 0);
+  }
+  SocketPair(const SocketPair &) = delete;
+  auto operator=(const SocketPair &) -> SocketPair & = delete;
+  ~SocketPair() {
+    close(fds[0]);
+    close(fds[1]);
+  }
+  std::array<int, 2> fds{};
+};
+
+// mirrors the descriptor layout in shm.cpp, to forge what a peer may send
+struct WireHeader {
+  uint32_t magic;
+  uint32_t n_columns;
+  uint64_t payload_bytes;
+};
+struct WireColumn {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  uint32_t format_len;
+  uint32_t name_len;
+};
+
+void send_forged(int const socket, int const fd, std::string const &payload,
+                 uint32_t const n_columns) {
+  std::string message(sizeof(WireHeader), '\0');
+  WireHeader const head{0x58415357U, n_columns, payload.size()};
+  std::memcpy(message.data(), &head, sizeof(head));
+  message += payload;
+  iovec iov{message.data(), message.size()};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int))> control{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+  auto *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+  REQUIRE(sendmsg(socket, &msg, 0) == static_cast<ssize_t>(message.size()));
+}
+
+void forge_column(std::string &payload, int64_t const length,
+                  uint64_t const values) {
+  WireColumn const wire{length, 0, 0, 2, 1, 1};
+  uint64_t const no_validity = UINT64_MAX;
+  payload.append(reinterpret_cast<const char *>(&wire), sizeof(wire));
+  payload.append(reinterpret_cast<const char *>(&no_validity), 8);
+  payload.append(reinterpret_cast<const char *>(&values), 8);
+  payload += "ix";
+}
+} // namespace
+
+TEST_CASE("shm allocator backs aligned vectors") {
+  ShmArena arena(1 << 16);
+  ShmVector<int64_t> vec(ShmAllocator{&arena});
+  vec.reserve(1000);
+  for (int64_t i = 0; i < 1000; ++i) {
+    vec.push_back(i);
+  }
+  CHECK(arena.contains(vec.data()));
+  CHECK(reinterpret_cast<std::uintptr_t>(vec.data()) % alignment == 0);
+  CHECK(arena.used() >= 1000 * sizeof(int64_t));
+  CHECK(vec[999] == 999);
+
+  ShmArena tiny(64);
+  ShmVector<int64_t> small(ShmAllocator{&tiny});
+  CHECK_THROWS_AS(small.reserve(1000), std::bad_alloc);
+}
+
+TEST_CASE("shm batch round trip") {
+  ShmArena arena(1 << 16);
+  ShmVector<int32_t> ints(ShmAllocator{&arena});
+  ShmVector<double> doubles(ShmAllocator{&arena});
+  ints.reserve(16);
+  doubles.reserve(16);
+  for (int32_t i = 0; i < 16; ++i) {
+    ints.push_back(i);
+    doubles.push_back(i * 0.5);
+  }
+
+  ShmBatchWriter writer(arena);
+  writer.add("ints", ints);
+  writer.add("doubles", doubles);
+  CHECK(writer.num_columns() == 2);
+
+  SocketPair sockets;
+  writer.send(sockets.fds[0]);
+  CHECK(arena.outstanding() == 1);
+
+  ArrowSchema schema{};
+  ArrowArray array{};
+  shm_receive(sockets.fds[1], schema, array);
+  REQUIRE(schema.n_children == 2);
+  CHECK(std::strcmp(schema.format, "+s") == 0);
+  CHECK(std::strcmp(schema.children[0]->format, "i") == 0);
+  CHECK(std::strcmp(schema.children[0]->name, "ints") == 0);
+  CHECK(std::strcmp(schema.children[1]->format, "g") == 0);
+  CHECK(std::strcmp(schema.children[1]->name, "doubles") == 0);
+
+  REQUIRE(array.n_children == 2);
+  CHECK(array.length == 16);
+  auto const *received =
+      static_cast<int32_t const *>(array.children[0]->buffers[1]);
+  // a separate mapping of the same pages
+  CHECK(received != ints.data());
+  CHECK(received[15] == 15);
+  ints[15] = 42;
+  CHECK(received[15] == 42);
+  CHECK(static_cast<double const *>(array.children[1]->buffers[1])[3] == 1.5);
+
+  CHECK_THROWS_AS(arena.reset(), std::logic_error);
+  schema.release(&schema);
+  array.release(&array);
+  CHECK(array.release == nullptr);
+  CHECK(arena.outstanding() == 0);
+  arena.reset();
+  CHECK(arena.used() == 0);
+}
+
+TEST_CASE("shm writer rejects heap buffers") {
+  ShmArena arena(1 << 12);
+  XArrowNonNull<int32_t> heap("heap");
+  heap.push_back(1);
+  ArrowSchema schema{};
+  ArrowArray array{};
+  heap.to_schema_ref(schema);
+  heap.to_array_ref(array);
+  ShmBatchWriter writer(arena);
+  CHECK_THROWS_AS(writer.add(schema, array), std::invalid_argument);
+}
+
+TEST_CASE("shm arena needs an explicit allocator") {
+  static_assert(!std::is_default_constructible_v<ShmVector<int32_t>>);
+  static_assert(
+      std::is_default_constructible_v<AlignedVector<int32_t, alignment>>);
+  ShmArena arena(1 << 12);
+  CHECK_NOTHROW(arena.at(arena.size() - 8, 8));
+  CHECK_THROWS_AS(arena.at(arena.size() - 8, 9), std::out_of_range);
+  CHECK_THROWS_AS(arena.at(0, 8), std::out_of_range);
+}
+
+TEST_CASE("shm receive rejects buffers past the mapping") {
+  ShmArena arena(1 << 12);
+  ShmVector<int64_t> values(ShmAllocator{&arena});
+  values.reserve(8);
+  for (int64_t i = 0; i < 8; ++i) {
+    values.push_back(i);
+  }
+  ArrowSchema schema{};
+  schema.format = "l";
+  schema.name = "values";
+  std::array<const void *, 2> buffers{nullptr, values.data()};
+  ArrowArray array{};
+  // claims far more values than the arena can hold
+  array.length = 1 << 20;
+  array.n_buffers = 2;
+  array.buffers = buffers.data();
+
+  ShmBatchWriter writer(arena);
+  writer.add(schema, array);
+  SocketPair sockets;
+  writer.send(sockets.fds[0]);
+  CHECK(arena.outstanding() == 1);
+
+  ArrowSchema received_schema{};
+  ArrowArray received{};
+  CHECK_THROWS_AS(shm_receive(sockets.fds[1], received_schema, received),
+                  std::out_of_range);
+  CHECK(received.release == nullptr);
+  CHECK(arena.outstanding() == 0);
+  arena.reset();
+  CHECK(arena.used() == 0);
+}
+
+TEST_CASE("shm children outlive the released batch") {
+  ShmArena arena(1 << 12);
+  ShmVector<int32_t> ints(ShmAllocator{&arena});
+  ints.reserve(4);
+  for (int32_t i = 0; i < 4; ++i) {
+    ints.push_back(i * 10);
+  }
+  ShmBatchWriter writer(arena);
+  writer.add("ints", ints);
+  SocketPair sockets;
+  writer.send(sockets.fds[0]);
+
+  ArrowSchema schema{};
+  ArrowArray array{};
+  shm_receive(sockets.fds[1], schema, array);
+  // move the column out, as the C data interface allows
+  ArrowSchema child_schema = *schema.children[0];
+  schema.children[0]->release = nullptr;
+  ArrowArray child = *array.children[0];
+  array.children[0]->release = nullptr;
+  schema.release(&schema);
+  array.release(&array);
+
+  CHECK(arena.outstanding() == 1);
+  CHECK(std::strcmp(child_schema.name, "ints") == 0);
+  CHECK(static_cast<int32_t const *>(child.buffers[1])[3] == 30);
+  child_schema.release(&child_schema);
+  child.release(&child);
+  CHECK(arena.outstanding() == 0);
+}
+
+TEST_CASE("shm receive rejects columns of different lengths") {
+  ShmArena arena(1 << 12);
+  auto *values = arena.allocate(alignment, 64);
+  REQUIRE(values != nullptr);
+  auto const offset = arena.offset_of(values);
+  std::string payload;
+  forge_column(payload, 4, offset);
+  forge_column(payload, 3, offset);
+
+  SocketPair sockets;
+  arena.retain();
+  send_forged(sockets.fds[0], arena.fd(), payload, 2);
+  ArrowSchema schema{};
+  ArrowArray array{};
+  CHECK_THROWS_AS(shm_receive(sockets.fds[1], schema, array),
+                  std::runtime_error);
+  CHECK(array.release == nullptr);
+  CHECK(arena.outstanding() == 0);
+}
@@ -0,0 +1,133 @@
+#include "doctest/doctest.h"
+#include "stats.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace xarrow;
+
+namespace {
+auto lookup(std::vector<std::pair<std::string, std::string>> const &pairs,
+            std::string const &key) -> std::string {
+  for (auto const &[k, v] : pairs) {
+    if (k == key) {
+      return v;
+    }
+  }
+  return "<missing>";
+}
+} // namespace
+
+TEST_CASE("zone maps prune time ordered blocks") {
+  StatsColumn<int64_t> ts("ts", 100);
+  for (int64_t i = 0; i < 1000; ++i) {
+    ts.push_back(i * 10);
+  }
+  ts.push_back(-5);
+  REQUIRE(ts.num_blocks() == 11);
+  CHECK(ts.zones()[3].min == 3000);
+  CHECK(ts.zones()[3].max == 3990);
+  CHECK(ts.zones()[10].count == 1);
+
+  auto const blocks = ts.candidate_blocks(2500, 2600);
+  REQUIRE(blocks.size() == 1);
+  CHECK(blocks[0] == 2);
+  auto const block = ts.block(blocks[0]);
+  CHECK(block.size() == 100);
+  CHECK(block[0] == 2000);
+
+  CHECK(ts.candidate_blocks(3990, 4000).size() == 2);
+  CHECK(ts.candidate_blocks(20000, 30000).empty());
+
+  auto const stats = ts.stats();
+  CHECK(stats.min == -5);
+  CHECK(stats.max == 9990);
+  CHECK(stats.count == 1001);
+  CHECK(stats.null_count == 0);
+}
+
+TEST_CASE("distinct estimate") {
+  StatsColumn<double> col("x");
+  std::vector<double> values;
+  for (int i = 0; i < 50000; ++i) {
+    values.push_back(static_cast<double>(i % 20000));
+  }
+  col.append(values.data(), values.size());
+  auto const distinct = col.stats().distinct;
+  CHECK(distinct > 19000);
+  CHECK(distinct < 21000);
+
+  StatsColumn<int32_t> small("y");
+  for (int i = 0; i < 100; ++i) {
+    small.push_back(i % 7);
+  }
+  CHECK(std::llround(small.stats().distinct) == 7);
+}
+
+TEST_CASE("statistics exported as schema metadata") {
+  StatsColumn<Timestamp> ts("ts", timestamp_format(TimeUnit::MILLI, "UTC"));
+  ArrowSchema schema{};
+  ts.to_schema_ref(schema);
+  auto pairs = decode_metadata(schema.metadata);
+  CHECK(lookup(pairs, "xarrow.stats.row_count") == "0");
+  CHECK(lookup(pairs, "xarrow.stats.min") == "<missing>");
+
+  ts.push_back({1700});
+  ts.push_back({-20});
+  ts.to_schema_move(schema);
+  CHECK(std::string(schema.format) == "tsm:UTC");
+  pairs = decode_metadata(schema.metadata);
+  CHECK(lookup(pairs, "xarrow.stats.row_count") == "2");
+  CHECK(lookup(pairs, "xarrow.stats.null_count") == "0");
+  CHECK(lookup(pairs, "xarrow.stats.distinct_count") == "2");
+  CHECK(lookup(pairs, "xarrow.stats.min") == "-20");
+  CHECK(lookup(pairs, "xarrow.stats.max") == "1700");
+  schema.release(&schema);
+
+  StatsColumn<Decimal128> dec("amount", decimal_format({30, 2, 128}));
+  dec.push_back(Decimal128::from_int64(-12345));
+  dec.push_back(Decimal128{0, 1});
+  pairs = decode_metadata(dec.metadata().c_str());
+  CHECK(lookup(pairs, "xarrow.stats.min") == "-12345");
+  CHECK(lookup(pairs, "xarrow.stats.max") == "18446744073709551616");
+
+  ArrowArray array{};
+  dec.to_array_move(array);
+  CHECK(array.length == 2);
+  CHECK(dec.size() == 0);
+  CHECK(dec.num_blocks() == 0);
+  array.release(&array);
+
+  CHECK(decode_metadata(nullptr).empty());
+  CHECK_THROWS_AS(StatsColumn<int32_t>("bad", 0), std::invalid_argument);
+}
+
+TEST_CASE("malformed metadata is rejected") {
+  auto const bytes = [](std::vector<int32_t> const &ints) {
+    std::string out(ints.size() * sizeof(int32_t), '\0');
+    std::memcpy(out.data(), ints.data(), out.size());
+    return out;
+  };
+  CHECK_THROWS_AS(decode_metadata(bytes({-1}).c_str()), std::runtime_error);
+  CHECK_THROWS_AS(decode_metadata(bytes({1, -5}).c_str()),
+                  std::runtime_error);
+  auto const negative_value = bytes({1, 0, -1});
+  CHECK_THROWS_AS(decode_metadata(negative_value.c_str()),
+                  std::runtime_error);
+  CHECK(decode_metadata(bytes({0}).c_str()).empty());
+}
+
+TEST_CASE("appends after a block slice keep the storage") {
+  StatsColumn<int32_t> col("v", 4);
+  for (int32_t i = 0; i < 5; ++i) {
+    col.push_back(i);
+  }
+  REQUIRE(col.column().data().capacity() > col.size());
+  auto const *storage = col.column().data().data();
+  auto const block = col.block(0);
+  col.push_back(5);
+  // the slice pins the buffer, the append must not copy it away
+  CHECK(col.column().data().data() == storage);
+  CHECK(block[3] == 3);
+  CHECK(col.size() == 6);
+}
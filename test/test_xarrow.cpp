@@ -0,0 +1,222 @@
+#include "doctest/doctest.h"
+#include "nested.hpp"
+#include "xarrow.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace xarrow;
+
+namespace {
+auto iota_vector(size_t const n, int32_t const start = 0)
+    -> AlignedVector<int32_t, alignment> {
+  AlignedVector<int32_t, alignment> vec;
+  for (size_t i = 0; i < n; ++i) {
+    vec.push_back(start + static_cast<int32_t>(i));
+  }
+  return vec;
+}
+} // namespace
+
+TEST_CASE("xarrow format strings") {
+  CHECK(std::strcmp(XArrowNonNull<int32_t>::format, "i") == 0);
+  CHECK(std::strcmp(XArrowNonNull<double>::format, "g") == 0);
+  CHECK(format2type_enum("L") == Type::UINT64);
+  CHECK(std::strcmp(type_enum2format(Type::INT8), "c") == 0);
+}
+
+TEST_CASE("xarrow slice shares storage") {
+  XArrowNonNull<int32_t> col("col", iota_vector(10));
+  auto s = col.slice(2, 5);
+  CHECK(s.size() == 5);
+  CHECK(s.offset() == 2);
+  CHECK(s[0] == 2);
+  CHECK(s.at(4) == 6);
+  CHECK_THROWS_AS(s.at(5), std::out_of_range);
+  CHECK(s.data() == col.data().data() + 2);
+
+  auto sub = s.slice(1, 3);
+  CHECK(sub.offset() == 3);
+  CHECK(sub[0] == 3);
+  CHECK(sub.size() == 3);
+
+  CHECK_THROWS_AS(col.slice(8, 3), std::out_of_range);
+  CHECK_THROWS_AS(s.slice(6, 0), std::out_of_range);
+  CHECK_NOTHROW(col.slice(10, 0));
+}
+
+TEST_CASE("xarrow slice outlives parent") {
+  std::unique_ptr<XArrowSlice<int32_t>> s;
+  {
+    XArrowNonNull<int32_t> col("col", iota_vector(100));
+    s = std::make_unique<XArrowSlice<int32_t>>(col.slice(90, 10));
+  }
+  CHECK(s->size() == 10);
+  CHECK((*s)[9] == 99);
+}
+
+TEST_CASE("xarrow slice export carries offset") {
+  ArrowArray moved{};
+  {
+    XArrowNonNull<int32_t> col("col", iota_vector(10));
+    auto s = col.slice(4, 3);
+
+    ArrowArray ref{};
+    s.to_array_ref(ref);
+    CHECK(ref.offset == 4);
+    CHECK(ref.length == 3);
+    CHECK(static_cast<int32_t const *>(ref.buffers[1])[ref.offset] == 4);
+
+    s.to_array_move(moved);
+  }
+  // export still owns the original storage
+  CHECK(moved.offset == 4);
+  CHECK(static_cast<int32_t const *>(moved.buffers[1])[moved.offset + 2] == 6);
+  moved.release(&moved);
+  CHECK(moved.release == nullptr);
+}
+
+TEST_CASE("xarrow column move export") {
+  XArrowNonNull<int32_t> col("col", iota_vector(8));
+  auto s = col.slice(6, 2);
+  ArrowArray array{};
+  col.to_array_move(array);
+  CHECK(array.length == 8);
+  CHECK(array.offset == 0);
+  CHECK(col.data().size() == 0);
+  array.release(&array);
+  // the slice keeps the exported storage alive
+  CHECK(s[1] == 7);
+
+  ArrowSchema schema{};
+  col.to_schema_move(schema);
+  CHECK(std::strcmp(schema.name, "col") == 0);
+  CHECK(std::strcmp(schema.format, "i") == 0);
+  schema.release(&schema);
+}
+
+TEST_CASE("xarrow slice export survives parent growth") {
+  XArrowNonNull<int32_t> col("col", iota_vector(4));
+  ArrowArray array{};
+  col.slice(1, 2).to_array_move(array);
+  auto const *before = col.data().data();
+  for (int32_t i = 0; i < 1000; ++i) {
+    col.push_back(i);
+  }
+  // the parent moved to a larger buffer, the old one stays with the export
+  CHECK(col.data().data() != before);
+  CHECK(col.data()[3] == 3);
+  auto const *values = static_cast<int32_t const *>(array.buffers[1]);
+  CHECK(values[array.offset] == 1);
+  CHECK(values[array.offset + 1] == 2);
+  array.release(&array);
+
+  // a moved-from column is empty but usable
+  col.to_array_move(array);
+  CHECK(col.data().empty());
+  col.push_back(7);
+  CHECK(col.data().size() == 1);
+  array.release(&array);
+}
+
+TEST_CASE("xarrow appends while sliced do not copy") {
+  XArrowNonNull<int32_t> col("col");
+  col.reserve(64);
+  auto const *storage = col.data().data();
+  std::vector<XArrowSlice<int32_t>> pages;
+  for (int32_t i = 0; i < 64; ++i) {
+    col.push_back(i);
+    pages.push_back(col.slice(static_cast<size_t>(i), 1));
+  }
+  CHECK(col.data().data() == storage);
+  CHECK(pages[10][0] == 10);
+
+  // in-place writes copy once, and the pages keep their values
+  col.detach()[10] = -1;
+  CHECK(col.data()[10] == -1);
+  CHECK(pages[10][0] == 10);
+  auto const *detached = col.data().data();
+  col.detach()[11] = -1;
+  CHECK(col.data().data() == detached);
+}
+
+TEST_CASE("xarrow imported slice owns its children") {
+  XArrowList<int32_t> list("ids");
+  list.append({1, 2});
+  list.append({3});
+  auto parent = std::make_shared<XArrowRawArray>();
+  list.to_array_move(*parent->import());
+
+  auto window = slice(parent, 1, 1);
+  auto &array = *window.import();
+  REQUIRE(array.n_children == 1);
+  CHECK(array.children != parent->schema().children);
+  CHECK(array.children[0] != parent->schema().children[0]);
+  CHECK(array.children[0]->buffers[1] ==
+        parent->schema().children[0]->buffers[1]);
+  parent.reset();
+
+  // a child moved out stays valid after the slice is released
+  ArrowArray child = *array.children[0];
+  array.children[0]->release = nullptr;
+  array.release(&array);
+  CHECK(static_cast<int32_t const *>(child.buffers[1])[2] == 3);
+  child.release(&child);
+  CHECK(child.release == nullptr);
+}
+
+TEST_CASE("xarrow imported array slice") {
+  auto parent = std::make_shared<XArrowRawArray>();
+  XArrowNonNull<int32_t> col("col", iota_vector(20));
+  col.to_array_move(*parent->import());
+
+  auto first = slice(parent, 5, 10);
+  CHECK(first.schema().offset == 5);
+  CHECK(first.schema().length == 10);
+  CHECK(first.schema().null_count == 0);
+
+  auto second = slice(std::make_shared<XArrowRawArray>(std::move(first)), 2, 3);
+  parent.reset();
+  CHECK(second.schema().offset == 7);
+  CHECK(second.schema().length == 3);
+  auto const *values = static_cast<int32_t const *>(second.schema().buffers[1]);
+  CHECK(values[second.schema().offset] == 7);
+
+  CHECK_THROWS_AS(slice(std::make_shared<XArrowRawArray>(), 0, 1),
+                  std::out_of_range);
+}
+
+TEST_CASE("chunked column random access") {
+  ChunkedColumn<int32_t> col("col");
+  col.append(iota_vector(3, 0));
+  col.append(AlignedVector<int32_t, alignment>());
+  col.append(iota_vector(5, 3));
+  col.append(iota_vector(2, 8));
+  CHECK(col.size() == 10);
+  CHECK(col.num_chunks() == 3);
+  for (size_t i = 0; i < col.size(); ++i) {
+    CHECK(col[i] == static_cast<int32_t>(i));
+  }
+  CHECK_THROWS_AS(col.at(10), std::out_of_range);
+}
+
+TEST_CASE("chunked column slice") {
+  ChunkedColumn<int32_t> col("col");
+  col.append(iota_vector(4, 0));
+  col.append(iota_vector(4, 4));
+  col.append(iota_vector(4, 8));
+
+  auto page = col.slice(2, 7);
+  CHECK(page.size() == 7);
+  CHECK(page.num_chunks() == 3);
+  CHECK(page.chunk(0).offset() == 2);
+  CHECK(page.chunk(2).size() == 1);
+  for (size_t i = 0; i < page.size(); ++i) {
+    CHECK(page[i] == static_cast<int32_t>(i + 2));
+  }
+  // pages alias the original chunks
+  CHECK(&page[0] == &col[2]);
+
+  CHECK(col.slice(12, 0).empty());
+  CHECK_THROWS_AS(col.slice(10, 3), std::out_of_range);
+}
@@ -8,6 +8,30 @@ set_languages("c++17")
 set_policy("build.warning", true)
 set_warnings("all", "extra")
 
+-- loader runs its pread fallback on a thread pool
+add_syslinks("pthread")
+
+-- `xmake f --metrics=n` compiles the instrumentation counters out
+option("metrics")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Enable allocation, export and kernel counters")
+option_end()
+if not has_config("metrics") then
+    add_defines("XARROW_METRICS=0")
+end
+
+-- `xmake f --zstd=y` lets the Parquet writer use ZSTD pages
+option("zstd")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Enable ZSTD compression in the Parquet writer")
+option_end()
+if has_config("zstd") then
+    add_requires("zstd")
+    add_defines("XARROW_WITH_ZSTD")
+end
+
 add_rules("plugin.compile_commands.autoupdate", {outputdir = ".vscode"})
 
 add_rules("mode.debug", "mode.release")
@@ -33,12 +57,18 @@ target("xarrow_static")
     set_kind("static")
     add_files("src/lib/*.cpp|test_*.cpp")
     add_includedirs("include", {public = true})
+    if has_config("zstd") then
+        add_packages("zstd")
+    end
     set_targetdir("build/lib")
 
 target("xarrow_shared")
     set_kind("shared")
     add_files("src/lib/*.cpp|test_*.cpp")
     add_includedirs("include", {public = true})
+    if has_config("zstd") then
+        add_packages("zstd")
+    end
     set_targetdir("build/lib")
 
 target("xarrow_test")
@@ -48,7 +78,11 @@ target("xarrow_test")
     set_pmxxheader("doctest/doctest.h")
     add_defines("TEST")
     add_deps("xarrow_static")
+    if has_config("zstd") then
+        add_packages("zstd")
+    end
     add_files("src/lib/*.cpp")
     add_includedirs("test/")
+    add_defines("XARROW_TEST_DATA=\"$(projectdir)/test/data\"")
     add_files("test/*.cpp")
     add_tests("default")